@@ -1,15 +1,75 @@
 #include "devices/input.h"
 #include <debug.h>
-#include "devices/intq.h"
+#include <stdio.h>
+#include <string.h>
 #include "devices/serial.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
 
-/* Stores keys from the keyboard and serial port. */
-static struct intq buffer;
+/* The TTY input layer.
+
+   Keys from the keyboard and serial port are added to BUFFER by
+   their interrupt handlers through input_putc(), which also runs
+   the line discipline.  In canonical mode (INPUT_CANON), keys are
+   collected into a line that can still be edited with backspace and
+   Ctrl+U, and only a complete line, ended by a new-line, a null
+   character or Ctrl+D, is handed to readers.  In raw mode
+   (INPUT_RAW) every key is available right away.  A reader sleeps
+   until there is something for it, so in canonical mode it is woken
+   once per line rather than once per key, and input_read() then
+   copies the whole line in one go. */
+
+/* Size of BUFFER, a power of 2. */
+#define INPUT_BUFSIZE 1024
+
+/* Keys with special meaning in canonical mode. */
+#define KEY_EOF 0x04            /* Ctrl+D: end the line, or end of file. */
+#define KEY_BS 0x08             /* Backspace: erase the last key. */
+#define KEY_KILL 0x15           /* Ctrl+U: erase the whole line. */
+#define KEY_DEL 0x7f            /* Delete: same as backspace. */
+
+/* Stores keys from the keyboard and serial port.  Key I is at
+   BUFFER[I % INPUT_BUFSIZE].  Keys [TAIL, LINE_END) are available to
+   readers, and keys [LINE_END, HEAD) are the line being edited, which
+   is always empty in raw mode.  Interrupts must be off to access
+   these. */
+static uint8_t buffer[INPUT_BUFSIZE];
+static unsigned head;           /* Next key is written here. */
+static unsigned line_end;       /* End of the keys available to readers. */
+static unsigned tail;           /* Next key is read from here. */
+
+/* Current mode, a combination of INPUT_* flags. */
+static int mode = INPUT_CANON;
+
+/* Allows only one reader to wait at a time. */
+static struct lock read_lock;
+
+/* Thread waiting for keys to become available, if any. */
+static struct thread *reader;
 
 /* Initializes the input buffer. */
 void
 input_init (void) {
-	intq_init (&buffer);
+	lock_init (&read_lock);
+}
+
+/* Echoes the N bytes in S to the console if echo is on. */
+static void
+echo (const char *s, size_t n) {
+	if (mode & INPUT_ECHO)
+		putbuf (s, n);
+}
+
+/* Makes every key in the buffer available to readers and wakes up the
+   waiting reader, if any. */
+static void
+complete_line (void) {
+	line_end = head;
+	if (reader != NULL && tail != line_end) {
+		thread_unblock (reader);
+		reader = NULL;
+	}
 }
 
 /* Adds a key to the input buffer.
@@ -17,32 +77,115 @@ input_init (void) {
 void
 input_putc (uint8_t key) {
 	ASSERT (intr_get_level () == INTR_OFF);
-	ASSERT (!intq_full (&buffer));
+	ASSERT (!input_full ());
+
+	if (mode & INPUT_CANON) {
+		switch (key) {
+			case KEY_BS:
+			case KEY_DEL:
+				if (head != line_end) {
+					head--;
+					echo ("\b \b", 3);
+				}
+				goto done;
+			case KEY_KILL:
+				for (; head != line_end; head--)
+					echo ("\b \b", 3);
+				goto done;
+			case '\r':
+				key = '\n';
+				break;
+		}
+	}
+
+	buffer[head++ % INPUT_BUFSIZE] = key;
+	if (key != KEY_EOF)
+		echo ((const char *) &key, 1);
 
-	intq_putc (&buffer, key);
+	/* A full buffer ends the line, since nothing more could be added
+	   to it before a reader takes something out. */
+	if (!(mode & INPUT_CANON) || key == '\n' || key == '\0' || key == KEY_EOF
+			|| input_full ())
+		complete_line ();
+
+done:
 	serial_notify ();
 }
 
-/* Retrieves a key from the input buffer.
-   If the buffer is empty, waits for a key to be pressed. */
-uint8_t
-input_getc (void) {
+/* Reads keys into BUF, which holds SIZE bytes, and returns the number
+   read.  If no keys are available, waits until some are.  In canonical
+   mode, reads at most one line, including the new-line or null
+   character that ends it; a line ended by Ctrl+D yields the keys before
+   it, so that Ctrl+D on its own yields 0 bytes, meaning end of file. */
+size_t
+input_read (void *buf_, size_t size) {
+	uint8_t *buf = buf_;
 	enum intr_level old_level;
-	uint8_t key;
+	size_t n = 0;
+
+	if (size == 0)
+		return 0;
 
+	lock_acquire (&read_lock);
 	old_level = intr_disable ();
-	key = intq_getc (&buffer);
+	while (tail == line_end) {
+		reader = thread_current ();
+		thread_block ();
+	}
+
+	if (mode & INPUT_CANON) {
+		while (n < size && tail != line_end) {
+			uint8_t key = buffer[tail++ % INPUT_BUFSIZE];
+			if (key == KEY_EOF)
+				break;
+			buf[n++] = key;
+			if (key == '\n' || key == '\0')
+				break;
+		}
+	} else {
+		while (n < size && tail != line_end)
+			buf[n++] = buffer[tail++ % INPUT_BUFSIZE];
+	}
+
 	serial_notify ();
 	intr_set_level (old_level);
+	lock_release (&read_lock);
+
+	return n;
+}
+
+/* Retrieves a key from the input buffer.
+   If the buffer is empty, waits for a key to be pressed. */
+uint8_t
+input_getc (void) {
+	uint8_t key = 0;
 
+	while (input_read (&key, 1) == 0)
+		continue;
 	return key;
 }
 
+/* Sets the input mode to MODE, a combination of INPUT_* flags, and
+   returns the previous mode.  Switching to raw mode makes the line
+   being edited available to readers. */
+int
+input_set_mode (int new_mode) {
+	enum intr_level old_level = intr_disable ();
+	int old_mode = mode;
+
+	mode = new_mode & (INPUT_CANON | INPUT_ECHO);
+	if (!(mode & INPUT_CANON))
+		complete_line ();
+	intr_set_level (old_level);
+
+	return old_mode;
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
 bool
 input_full (void) {
 	ASSERT (intr_get_level () == INTR_OFF);
-	return intq_full (&buffer);
+	return head - tail == INPUT_BUFSIZE;
 }
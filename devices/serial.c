@@ -1,7 +1,6 @@
 #include "devices/serial.h"
 #include <debug.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +32,14 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable the receive and transmit FIFOs. */
+#define FCR_CLEAR_RECV 0x02     /* Clear the receive FIFO. */
+#define FCR_CLEAR_XMIT 0x04     /* Clear the transmit FIFO. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* Both set if the FIFOs are enabled. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -46,16 +53,33 @@
 
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
-#define LSR_THRE 0x20           /* THR Empty. */
+#define LSR_THRE 0x20           /* THR Empty, or transmit FIFO empty. */
+
+/* Size of the 16550A's transmit FIFO. */
+#define XMIT_FIFO_SIZE 16
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Bytes the UART accepts at once when LSR_THRE is set: the size of its
+   transmit FIFO, or 1 for an older UART without a working one. */
+static int xmit_burst = 1;
+
+/* Data to be transmitted.  TXQ_SIZE is a power of 2, and bytes
+   [TXQ_TAIL, TXQ_HEAD) of TXQ, taken modulo TXQ_SIZE, are waiting.
+   Interrupts must be off to access these. */
+#define TXQ_SIZE 4096
+static uint8_t txq[TXQ_SIZE];
+static unsigned txq_head;       /* New data is written here. */
+static unsigned txq_tail;       /* Old data is read here. */
+
+/* Thread waiting for room in TXQ, if any. */
+static struct thread *txq_waiter;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void xmit_poll (void);
+static void xmit_burst_out (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -70,10 +94,15 @@ init_poll (void) {
 	outb (FCR_REG, 0);                    /* Disable FIFO. */
 	set_serial (115200);                  /* 115.2 kbps, N-8-1. */
 	outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-	intq_init (&txq);
 	mode = POLL;
 }
 
+/* Returns the number of bytes waiting in TXQ. */
+static unsigned
+txq_cnt (void) {
+	return txq_head - txq_tail;
+}
+
 /* Initializes the serial port device for queued interrupt-driven
    I/O.  With interrupt-driven I/O we don't waste CPU time
    waiting for the serial device to become ready. */
@@ -86,49 +115,80 @@ serial_init_queue (void) {
 	ASSERT (mode == POLL);
 
 	intr_register_ext (0x20 + 4, serial_interrupt, "serial");
+
+	/* Turn on the FIFOs.  Only a 16550A reports them as enabled;
+	   older UARTs keep sending a byte per interrupt. */
+	outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RECV | FCR_CLEAR_XMIT);
+	if ((inb (IIR_REG) & IIR_FIFO) == IIR_FIFO)
+		xmit_burst = XMIT_FIFO_SIZE;
+	else
+		outb (FCR_REG, 0);
+
 	mode = QUEUE;
 	old_level = intr_disable ();
 	write_ier ();
 	intr_set_level (old_level);
 }
 
-/* Sends BYTE to the serial port. */
+/* Sends the N bytes in BUF to the serial port. */
 void
-serial_putc (uint8_t byte) {
+serial_write (const void *buf_, size_t n) {
+	const uint8_t *buf = buf_;
 	enum intr_level old_level = intr_disable ();
 
 	if (mode != QUEUE) {
 		/* If we're not set up for interrupt-driven I/O yet,
-		   use dumb polling to transmit a byte. */
+		   use dumb polling to transmit. */
 		if (mode == UNINIT)
 			init_poll ();
-		putc_poll (byte);
+		while (n-- > 0)
+			putc_poll (*buf++);
 	} else {
-		/* Otherwise, queue a byte and update the interrupt enable
-		   register. */
-		if (old_level == INTR_OFF && intq_full (&txq)) {
-			/* Interrupts are off and the transmit queue is full.
-			   If we wanted to wait for the queue to empty,
-			   we'd have to reenable interrupts.
-			   That's impolite, so we'll send a character via
-			   polling instead. */
-			putc_poll (intq_getc (&txq));
+		while (n > 0) {
+			if (txq_cnt () == TXQ_SIZE) {
+				if (old_level == INTR_OFF || txq_waiter != NULL) {
+					/* Interrupts are off and the transmit queue is
+					   full.  If we wanted to wait for the queue to
+					   empty, we'd have to reenable interrupts.
+					   That's impolite, so we'll send a FIFO's worth
+					   via polling instead.  We do the same if
+					   another thread is already waiting. */
+					xmit_poll ();
+				} else {
+					/* Sleep until the interrupt handler makes
+					   room. */
+					write_ier ();
+					txq_waiter = thread_current ();
+					thread_block ();
+				}
+				continue;
+			}
+
+			/* Queue as much as fits in one go. */
+			while (n > 0 && txq_cnt () < TXQ_SIZE) {
+				txq[txq_head++ % TXQ_SIZE] = *buf++;
+				n--;
+			}
 		}
-
-		intq_putc (&txq, byte);
 		write_ier ();
 	}
 
 	intr_set_level (old_level);
 }
 
+/* Sends BYTE to the serial port. */
+void
+serial_putc (uint8_t byte) {
+	serial_write (&byte, 1);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void
 serial_flush (void) {
 	enum intr_level old_level = intr_disable ();
-	while (!intq_empty (&txq))
-		putc_poll (intq_getc (&txq));
+	while (txq_cnt () > 0)
+		xmit_poll ();
 	intr_set_level (old_level);
 }
 
@@ -171,7 +231,7 @@ write_ier (void) {
 
 	/* Enable transmit interrupt if we have any characters to
 	   transmit. */
-	if (!intq_empty (&txq))
+	if (txq_cnt () > 0)
 		ier |= IER_XMIT;
 
 	/* Enable receive interrupt if we have room to store any
@@ -193,6 +253,25 @@ putc_poll (uint8_t byte) {
 	outb (THR_REG, byte);
 }
 
+/* Moves up to a FIFO's worth of bytes from TXQ to the UART, which must
+   be ready to accept them. */
+static void
+xmit_burst_out (void) {
+	for (int i = 0; i < xmit_burst && txq_cnt () > 0; i++)
+		outb (THR_REG, txq[txq_tail++ % TXQ_SIZE]);
+}
+
+/* Polls the serial port until it's ready,
+   and then transmits a FIFO's worth of bytes from TXQ. */
+static void
+xmit_poll (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while ((inb (LSR_REG) & LSR_THRE) == 0)
+		continue;
+	xmit_burst_out ();
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) {
@@ -205,10 +284,16 @@ serial_interrupt (struct intr_frame *f UNUSED) {
 	while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
 		input_putc (inb (RBR_REG));
 
-	/* As long as we have a byte to transmit, and the hardware is
-	   ready to accept a byte for transmission, transmit a byte. */
-	while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
-		outb (THR_REG, intq_getc (&txq));
+	/* If the hardware is ready to accept bytes for transmission,
+	   fill its transmit FIFO. */
+	if (txq_cnt () > 0 && (inb (LSR_REG) & LSR_THRE) != 0)
+		xmit_burst_out ();
+
+	/* Wake up a writer waiting for room. */
+	if (txq_waiter != NULL && txq_cnt () < TXQ_SIZE) {
+		thread_unblock (txq_waiter);
+		txq_waiter = NULL;
+	}
 
 	/* Update interrupt enable register based on queue status. */
 	write_ier ();
@@ -1,13 +1,17 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "threads/malloc.h"
 
-/* An open file. */
+/* An open file, which is either an inode or one end of a pipe. */
 struct file {
-	struct inode *inode;        /* File's inode. */
+	struct inode *inode;        /* File's inode, or null for a pipe. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	int ref_cnt;                /* Number of file_close() calls to free. */
+	struct pipe *pipe;          /* Pipe, or null for an inode. */
+	bool pipe_writer;           /* Is this the write end of PIPE? */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -20,6 +24,7 @@ file_open (struct inode *inode) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ref_cnt = 1;
 		return file;
 	} else {
 		inode_close (inode);
@@ -28,6 +33,37 @@ file_open (struct inode *inode) {
 	}
 }
 
+/* Opens a file for the write end of PIPE if WRITER is true, otherwise
+ * for the read end, taking ownership of one reference to that end.
+ * Returns a null pointer if an allocation fails. */
+struct file *
+file_open_pipe (struct pipe *pipe, bool writer) {
+	struct file *file = calloc (1, sizeof *file);
+	if (file != NULL) {
+		file->pipe = pipe;
+		file->pipe_writer = writer;
+		file->ref_cnt = 1;
+	}
+	return file;
+}
+
+/* Returns the pipe FILE is an end of, or a null pointer if FILE is not
+ * a pipe.  If it is, stores in *WRITER whether it is the write end. */
+struct pipe *
+file_get_pipe (struct file *file, bool *writer) {
+	if (file->pipe != NULL && writer != NULL)
+		*writer = file->pipe_writer;
+	return file->pipe;
+}
+
+/* Returns FILE itself, with one more reference, for sharing between two
+ * file descriptors.  FILE is then freed by the second file_close(). */
+struct file *
+file_dup (struct file *file) {
+	file->ref_cnt++;
+	return file;
+}
+
 /* Opens and returns a new file for the same inode as FILE.
  * Returns a null pointer if unsuccessful. */
 struct file *
@@ -39,7 +75,15 @@ file_reopen (struct file *file) {
  * same inode as FILE. Returns a null pointer if unsuccessful. */
 struct file *
 file_duplicate (struct file *file) {
-	struct file *nfile = file_open (inode_reopen (file->inode));
+	struct file *nfile;
+
+	if (file->pipe != NULL) {
+		nfile = file_open_pipe (file->pipe, file->pipe_writer);
+		if (nfile != NULL)
+			pipe_ref (file->pipe, file->pipe_writer);
+		return nfile;
+	}
+	nfile = file_open (inode_reopen (file->inode));
 	if (nfile) {
 		nfile->pos = file->pos;
 		if (file->deny_write)
@@ -51,9 +95,13 @@ file_duplicate (struct file *file) {
 /* Closes FILE. */
 void
 file_close (struct file *file) {
-	if (file != NULL) {
-		file_allow_write (file);
-		inode_close (file->inode);
+	if (file != NULL && --file->ref_cnt == 0) {
+		if (file->pipe != NULL)
+			pipe_unref (file->pipe, file->pipe_writer);
+		else {
+			file_allow_write (file);
+			inode_close (file->inode);
+		}
 		free (file);
 	}
 }
@@ -33,6 +33,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	unsigned generation;                /* Changes when data or state does. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -125,6 +126,7 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	inode->generation = 0;
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	return inode;
 }
@@ -168,12 +170,26 @@ inode_close (struct inode *inode) {
 	}
 }
 
+/* Function that inode_remove() calls, or a null pointer. */
+static inode_remove_func *remove_hook;
+
+/* Makes inode_remove() call HOOK with each inode it removes, so that
+ * a cache that keeps inodes open can close them and let the file's
+ * sectors be freed. */
+void
+inode_set_remove_hook (inode_remove_func *hook) {
+	remove_hook = hook;
+}
+
 /* Marks INODE to be deleted when it is closed by the last caller who
  * has it open. */
 void
 inode_remove (struct inode *inode) {
 	ASSERT (inode != NULL);
 	inode->removed = true;
+	inode->generation++;
+	if (remove_hook != NULL)
+		remove_hook (inode);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -283,6 +299,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		bytes_written += chunk_size;
 	}
 	free (bounce);
+	if (bytes_written > 0)
+		inode->generation++;
 
 	return bytes_written;
 }
@@ -306,6 +324,14 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+/* Returns INODE's generation, which changes whenever INODE is written or
+ * removed.  Only meaningful while INODE is kept open, since a reopened
+ * inode starts over at 0. */
+unsigned
+inode_generation (const struct inode *inode) {
+	return inode->generation;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
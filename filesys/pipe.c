@@ -0,0 +1,165 @@
+/* pipe.c: Anonymous pipes.
+ *
+ * A pipe is a ring buffer of PIPE_SIZE bytes with a read end and a
+ * write end, each of which may be open in any number of files.  A
+ * reader waits while the pipe is empty and a writer while it is full.
+ * Once every write end is closed, readers get what is left and then
+ * end of file; once every read end is closed, writes fail.  Data is
+ * moved with at most two memcpy() calls per transfer, one on either
+ * side of the point where the ring wraps, so a page written in one
+ * go goes in as a page. */
+
+#include "filesys/pipe.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Pages in a pipe's buffer. */
+#define PIPE_PAGES 4
+
+/* Bytes in a pipe's buffer, a power of 2. */
+#define PIPE_SIZE (PIPE_PAGES * PGSIZE)
+
+struct pipe {
+	struct lock lock;           /* Protects everything below. */
+	struct condition not_empty; /* Data arrived, or no writers are left. */
+	struct condition not_full;  /* Room freed, or no readers are left. */
+	uint8_t *buf;               /* PIPE_SIZE bytes. */
+	size_t head;                /* Bytes ever written. */
+	size_t tail;                /* Bytes ever read. */
+	int readers;                /* Open read ends. */
+	int writers;                /* Open write ends. */
+};
+
+/* Creates a pipe with one open read end and one open write end.
+ * Returns a null pointer if memory is short. */
+struct pipe *
+pipe_create (void) {
+	struct pipe *pipe = malloc (sizeof *pipe);
+
+	if (pipe == NULL)
+		return NULL;
+	pipe->buf = palloc_get_multiple (0, PIPE_PAGES);
+	if (pipe->buf == NULL) {
+		free (pipe);
+		return NULL;
+	}
+	lock_init (&pipe->lock);
+	cond_init (&pipe->not_empty);
+	cond_init (&pipe->not_full);
+	pipe->head = pipe->tail = 0;
+	pipe->readers = pipe->writers = 1;
+	return pipe;
+}
+
+/* Opens another write end of PIPE if WRITER is true, otherwise another
+ * read end. */
+void
+pipe_ref (struct pipe *pipe, bool writer) {
+	lock_acquire (&pipe->lock);
+	if (writer)
+		pipe->writers++;
+	else
+		pipe->readers++;
+	lock_release (&pipe->lock);
+}
+
+/* Closes a write end of PIPE if WRITER is true, otherwise a read end.
+ * Frees PIPE when the last end is closed. */
+void
+pipe_unref (struct pipe *pipe, bool writer) {
+	bool last;
+
+	lock_acquire (&pipe->lock);
+	if (writer) {
+		ASSERT (pipe->writers > 0);
+		if (--pipe->writers == 0)
+			cond_broadcast (&pipe->not_empty, &pipe->lock);
+	} else {
+		ASSERT (pipe->readers > 0);
+		if (--pipe->readers == 0)
+			cond_broadcast (&pipe->not_full, &pipe->lock);
+	}
+	last = pipe->readers == 0 && pipe->writers == 0;
+	lock_release (&pipe->lock);
+
+	if (last) {
+		palloc_free_multiple (pipe->buf, PIPE_PAGES);
+		free (pipe);
+	}
+}
+
+/* Copies N bytes between BUF and the ring of PIPE at byte POS of
+ * everything ever written, into the ring if TO_RING is true. */
+static void
+ring_copy (struct pipe *pipe, size_t pos, void *buf, size_t n, bool to_ring) {
+	size_t ofs = pos % PIPE_SIZE;
+	size_t first = n < PIPE_SIZE - ofs ? n : PIPE_SIZE - ofs;
+
+	if (to_ring) {
+		memcpy (pipe->buf + ofs, buf, first);
+		memcpy (pipe->buf, (uint8_t *) buf + first, n - first);
+	} else {
+		memcpy (buf, pipe->buf + ofs, first);
+		memcpy ((uint8_t *) buf + first, pipe->buf, n - first);
+	}
+}
+
+/* Reads up to SIZE bytes from PIPE into BUFFER, waiting until there is
+ * something to read.  Returns the number of bytes read, which is 0 at
+ * end of file, when the pipe is empty and has no writers. */
+off_t
+pipe_read (struct pipe *pipe, void *buffer, off_t size) {
+	size_t n;
+
+	if (size <= 0)
+		return 0;
+	lock_acquire (&pipe->lock);
+	while (pipe->head == pipe->tail && pipe->writers > 0)
+		cond_wait (&pipe->not_empty, &pipe->lock);
+	n = pipe->head - pipe->tail;
+	if (n > (size_t) size)
+		n = size;
+	ring_copy (pipe, pipe->tail, buffer, n, false);
+	pipe->tail += n;
+	if (n > 0)
+		cond_broadcast (&pipe->not_full, &pipe->lock);
+	lock_release (&pipe->lock);
+	return n;
+}
+
+/* Writes SIZE bytes from BUFFER to PIPE, waiting for room as needed.
+ * Returns the number of bytes written, which is less than SIZE only if
+ * the last reader closes its end first, and -1 if there were no readers
+ * to begin with. */
+off_t
+pipe_write (struct pipe *pipe, const void *buffer, off_t size) {
+	const uint8_t *buf = buffer;
+	off_t written = 0;
+
+	lock_acquire (&pipe->lock);
+	if (pipe->readers == 0) {
+		lock_release (&pipe->lock);
+		return -1;
+	}
+	while (written < size && pipe->readers > 0) {
+		size_t room = PIPE_SIZE - (pipe->head - pipe->tail);
+		size_t n = (size_t) (size - written);
+
+		if (room == 0) {
+			cond_wait (&pipe->not_full, &pipe->lock);
+			continue;
+		}
+		if (n > room)
+			n = room;
+		ring_copy (pipe, pipe->head, (void *) (buf + written), n, true);
+		pipe->head += n;
+		written += n;
+		cond_broadcast (&pipe->not_empty, &pipe->lock);
+	}
+	lock_release (&pipe->lock);
+	return written;
+}
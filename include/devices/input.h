@@ -2,11 +2,19 @@
 #define DEVICES_INPUT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/* Input modes for input_set_mode(). */
+#define INPUT_RAW 0             /* Keys are available as they arrive. */
+#define INPUT_CANON 0x1         /* Keys are available a line at a time. */
+#define INPUT_ECHO 0x2          /* Echo keys to the console. */
+
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
+size_t input_read (void *, size_t);
+int input_set_mode (int);
 bool input_full (void);
 
 #endif /* devices/input.h */
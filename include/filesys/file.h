@@ -3,14 +3,20 @@
 
 #include "filesys/off_t.h"
 
+#include <stdbool.h>
+
 struct inode;
+struct pipe;
 
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
+struct file *file_open_pipe (struct pipe *, bool writer);
 struct file *file_reopen (struct file *);
 struct file *file_duplicate (struct file *file);
+struct file *file_dup (struct file *);
 void file_close (struct file *);
 struct inode *file_get_inode (struct file *);
+struct pipe *file_get_pipe (struct file *, bool *writer);
 
 /* Reading and writing. */
 off_t file_read (struct file *, void *, off_t);
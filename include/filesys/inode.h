@@ -6,6 +6,10 @@
 #include "devices/disk.h"
 
 struct bitmap;
+struct inode;
+
+/* Called by inode_remove() with the inode it removes. */
+typedef void inode_remove_func (struct inode *);
 
 void inode_init (void);
 bool inode_create (disk_sector_t, off_t);
@@ -14,10 +18,12 @@ struct inode *inode_reopen (struct inode *);
 disk_sector_t inode_get_inumber (const struct inode *);
 void inode_close (struct inode *);
 void inode_remove (struct inode *);
+void inode_set_remove_hook (inode_remove_func *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
+unsigned inode_generation (const struct inode *);
 off_t inode_length (const struct inode *);
 
 #endif /* filesys/inode.h */
@@ -0,0 +1,15 @@
+#ifndef FILESYS_PIPE_H
+#define FILESYS_PIPE_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+struct pipe;
+
+struct pipe *pipe_create (void);
+void pipe_ref (struct pipe *, bool writer);
+void pipe_unref (struct pipe *, bool writer);
+off_t pipe_read (struct pipe *, void *, off_t size);
+off_t pipe_write (struct pipe *, const void *, off_t size);
+
+#endif /* filesys/pipe.h */
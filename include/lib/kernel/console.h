@@ -1,8 +1,15 @@
 #ifndef __LIB_KERNEL_CONSOLE_H
 #define __LIB_KERNEL_CONSOLE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 void console_init (void);
+void console_start (void);
 void console_panic (void);
+void console_flush (void);
 void console_print_stats (void);
+uint64_t console_log_size (void);
+size_t console_log_read (uint64_t *pos, char *buf, size_t size);
 
 #endif /* lib/kernel/console.h */
@@ -36,6 +36,52 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_MADVISE,                /* Advise on the use of a memory range. */
+	SYS_VMSTAT,                 /* Obtain this process's paging statistics. */
+	SYS_SPAWN,                  /* Start a new process running a program. */
+
+	/* Extra I/O. */
+	SYS_READV,                  /* Read from a file into several buffers. */
+	SYS_WRITEV,                 /* Write several buffers to a file. */
+	SYS_PREAD,                  /* Read from a file at a given position. */
+	SYS_PWRITE,                 /* Write to a file at a given position. */
+	SYS_RING_ENTER,             /* Submit queued requests in a ring. */
+	SYS_COPY_FILE_RANGE,        /* Copy data between two files. */
+	SYS_SYSSTAT,                /* Obtain system call statistics. */
+	SYS_DMESG,                  /* Read the kernel log. */
+	SYS_TTYMODE,                /* Set the console input mode. */
+	SYS_PIPE,                   /* Create a pipe. */
+};
+
+/* Flag ORed into the WRITABLE argument of mmap() to load the whole
+ * mapping right away instead of on first access. */
+#define MAP_POPULATE 0x100
+
+/* ADVICE values for madvise(). */
+enum {
+	MADV_NORMAL,                /* No particular access pattern. */
+	MADV_RANDOM,                /* Random access: load nothing extra. */
+	MADV_SEQUENTIAL,            /* Sequential access: load far ahead. */
+	MADV_WILLNEED,              /* Will be accessed soon: load it now. */
+	MADV_DONTNEED,              /* Not needed soon: evict it now. */
 };
 
+/* Operations queued in the submission ring of ring_enter(). */
+enum {
+	RING_OP_NOP,                /* Do nothing. */
+	RING_OP_READ,               /* read(), or pread() if OFFSET >= 0. */
+	RING_OP_WRITE,              /* write(), or pwrite() if OFFSET >= 0. */
+	RING_OP_OPEN,               /* open() the file named at ADDR. */
+	RING_OP_CLOSE,              /* close(). */
+	RING_OP_SEEK,               /* seek() to OFFSET. */
+};
+
+/* MODE values for ttymode(): TTY_RAW or TTY_CANON, optionally ORed
+ * with TTY_ECHO. */
+#define TTY_RAW 0                   /* read() returns keys as they arrive. */
+#define TTY_CANON 0x1               /* read() returns a line at a time. */
+#define TTY_ECHO 0x2                /* Echo keys to the console. */
+
 #endif /* lib/syscall-nr.h */
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <syscall-nr.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -13,6 +15,76 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* Paging statistics of a process, filled in by vmstat(). */
+struct vmstat {
+	long long minor_faults;     /* Page faults resolved without I/O. */
+	long long major_faults;     /* Page faults that read from disk. */
+	long long cow_faults;       /* Writes to a copy-on-write page. */
+	long long stack_faults;     /* Page faults that grew the stack. */
+	long long swap_ins;         /* Pages read back from swap. */
+	long long rss;              /* Pages resident now. */
+	long long peak_rss;         /* Most pages ever resident at once. */
+};
+
+/* A buffer for readv() and writev(). */
+struct iovec {
+	void *iov_base;             /* Start of the buffer. */
+	size_t iov_len;             /* Length of the buffer in bytes. */
+};
+
+/* Maximum number of buffers passed to readv() or writev(). */
+#define IOV_MAX 256
+
+/* A request in the submission ring of an io_ring. */
+struct ring_sqe {
+	int opcode;                 /* RING_OP_*. */
+	int fd;                     /* File descriptor. */
+	void *addr;                 /* Buffer, or file name for RING_OP_OPEN. */
+	unsigned len;               /* Buffer length in bytes. */
+	off_t offset;               /* File position, or -1 for the current one. */
+	uint64_t user_data;         /* Passed back in the completion. */
+};
+
+/* A completion in the completion ring of an io_ring. */
+struct ring_cqe {
+	uint64_t user_data;         /* From the request. */
+	int res;                    /* What the matching system call returns. */
+};
+
+/* A pair of rings in user memory, shared with the kernel through
+   ring_enter().  Both rings have MASK + 1 entries, a power of 2, and
+   entry I of a ring is at index I & MASK.  The process queues requests
+   at SQ_TAIL and reaps completions at CQ_HEAD; the kernel consumes
+   requests at SQ_HEAD and posts completions at CQ_TAIL. */
+struct io_ring {
+	unsigned sq_head;           /* Next request for the kernel. */
+	unsigned sq_tail;           /* Next free request slot. */
+	unsigned cq_head;           /* Next completion for the process. */
+	unsigned cq_tail;           /* Next free completion slot. */
+	unsigned mask;              /* Number of entries minus 1. */
+	struct ring_sqe *sqes;      /* Submission ring. */
+	struct ring_cqe *cqes;      /* Completion ring. */
+};
+
+/* Number of latency buckets in a struct sysstat. */
+#define SYSSTAT_BUCKETS 16
+
+/* Calls whose latency is below 2**SYSSTAT_SHIFT cycles are counted in
+   bucket 0 of a struct sysstat. */
+#define SYSSTAT_SHIFT 10
+
+/* Statistics of one system call, filled in by sysstat().  Bucket I of
+   HIST counts calls that took fewer than 2**(SYSSTAT_SHIFT + I) cycles
+   but, for I > 0, at least half as many; the last bucket also counts
+   every slower call.  Calls that never return, such as exit(), count
+   in CALLS only. */
+struct sysstat {
+	long long calls;            /* Times called. */
+	long long errors;           /* Calls that reported failure. */
+	long long cycles;           /* Total time spent, in TSC cycles. */
+	unsigned hist[SYSSTAT_BUCKETS]; /* Latency histogram. */
+};
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -25,6 +97,7 @@ void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t fork(const char *thread_name);
 int exec (const char *file);
+pid_t spawn (const char *cmd_line, const int *fd_map, size_t fd_cnt);
 int wait (pid_t);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
@@ -35,12 +108,25 @@ int write (int fd, const void *buffer, unsigned length);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int ring_enter (struct io_ring *ring, unsigned to_submit);
+int copy_file_range (int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+		size_t length);
+bool sysstat (int syscall_nr, bool system_wide, struct sysstat *);
+int dmesg (char *buffer, unsigned length);
+int ttymode (int mode);
+int pipe (int fds[2]);
 
 int dup2(int oldfd, int newfd);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
+bool vmstat (struct vmstat *);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
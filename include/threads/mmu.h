@@ -7,6 +7,7 @@
 
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
+void pcid_init (void);
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
@@ -30,8 +30,8 @@ typedef int tid_t;
 #define PRI_MAX 63     /* Highest priority. */
 
 /* File descriptor*/
-#define FD_MIN 2   /* Lowest File descriptor */
-#define FD_MAX 127 /* Highest File descriptor */
+#define FD_MIN 2    /* Lowest File descriptor */
+#define FD_MAX 1024 /* File descriptors are below this */
 
 #define STDIN_FILENO 0
 #define STDOUT_FILENO 1
@@ -104,8 +104,9 @@ struct thread
    struct lock *wait_on_lock;   // 해당 쓰레드가 대기하고 있는 lock자료구조의 주소를 저장할 필드
    struct list list_donation;   // multiple donation을 고려하기 위한 리스트
    struct list_elem d_elem;     // 해당 리스트를 위한 elem도 추가
-   struct file **fdt;       // 파일 디스크립터 테이블
-   int next_fd;                 // 테이블 중 비어있는 곳
+   struct file **fdt;           // 파일 디스크립터 테이블 (처음 파일을 열 때 할당)
+   uint64_t *fd_used;           // fdt에서 사용 중인 칸의 비트맵
+   int fd_cap;                  // fdt의 칸 수 (64의 배수)
    struct list child_list;      // 자식 스레드 리스트
    struct list_elem child_elem; // 자식 스레드 리스트를 위한 elem
 
@@ -125,10 +126,13 @@ struct thread
 #ifdef USERPROG
    /* Owned by userprog/process.c. */
    uint64_t *pml4; /* Page map level 4 */
+   struct sysstat *syscall_stats; /* Per-system-call statistics, or null. */
 #endif
 #ifdef VM
    /* Table for whole virtual memory owned by thread. */
    struct supplemental_page_table spt;
+   void *user_rsp; /* User stack pointer saved on entry to a system call. */
+   struct vm_stats vm_stats; /* Paging statistics. */
 #endif
 
    /* Owned by thread.c. */
@@ -6,12 +6,16 @@
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
+tid_t process_spawn (const char *cmd_line, const int *fd_map, size_t fd_cnt);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
+void process_exec_cache_init (void);
+void process_print_stats (void);
 int process_add_file (struct file *f);
 struct file *process_get_file(int fd);
 void process_close_file(int fd);
+int process_dup2(int oldfd, int newfd);
 void remove_child_process(struct thread *cp);
 
 #endif /* userprog/process.h */
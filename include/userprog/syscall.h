@@ -4,7 +4,11 @@
 #define USERPROG_SYSCALL_H
 
 void syscall_init (void);
+void syscall_print_stats (void);
 
-struct lock filesys_lock;
+/* -scstats: Print system call and exec cache statistics at power off? */
+extern bool syscall_exit_stats;
+
+extern struct lock filesys_lock;
 
 #endif /* userprog/syscall.h */
@@ -1,13 +1,17 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
+#include <stddef.h>
 #include "vm/vm.h"
 struct page;
 enum vm_type;
 
 struct anon_page {
+	size_t swap_slot;           /* Swap slot holding the page, or
+	                               SWAP_SLOT_NONE while it is in memory. */
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void anon_share (struct page *dst, struct page *src);
 
 #endif
@@ -4,13 +4,37 @@
 #include "vm/vm.h"
 
 struct page;
+struct frame;
 enum vm_type;
 
+/* Lazy-load descriptor, passed as the AUX of every page whose initial
+ * contents come from a file (executable segments and mmap regions).
+ * It owns its FILE handle until the page is initialized. */
+struct file_load_info {
+	struct file *file;          /* Private handle to the backing file. */
+	off_t ofs;                  /* Offset of the page's data in FILE. */
+	size_t read_bytes;          /* Bytes to read; the rest is zeroed. */
+	size_t mapped_pages;        /* Pages in the mapping, for its first page. */
+	bool shared;                /* Read-only text, shareable across processes. */
+};
+
 struct file_page {
+	struct file *file;          /* Private handle to the backing file. */
+	off_t ofs;                  /* Offset of the page's data in FILE. */
+	size_t read_bytes;          /* Bytes backed by FILE; the rest is zero. */
+	size_t mapped_pages;        /* Pages in the mapping, 0 if not its start. */
+	bool shared;                /* Read-only text, shareable across processes. */
 };
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool file_load_page (struct page *page, void *aux);
+struct file_load_info *file_load_info_dup (const struct file_load_info *);
+void file_load_info_free (struct file_load_info *);
+bool file_text_share (struct page *page);
+void file_text_register (struct page *page);
+void file_text_forget (struct frame *frame);
+bool file_backed_clean (struct page *page);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
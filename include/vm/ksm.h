@@ -0,0 +1,13 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include <stdbool.h>
+
+/* If true, merge identical anonymous pages in the background.
+   Controlled by kernel command-line option "-ksm". */
+extern bool ksm_enabled;
+
+void ksm_init (void);
+void ksm_count_unmerge (void);
+void ksm_print_stats (void);
+
+#endif /* vm/ksm.h */
@@ -0,0 +1,15 @@
+#ifndef VM_RECLAIM_H
+#define VM_RECLAIM_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* If true (default), reclaim frames in the background.
+   Cleared by kernel command-line option "-noreclaim". */
+extern bool reclaim_enabled;
+
+void reclaim_init (void);
+void reclaim_check (size_t free_cnt);
+void reclaim_count_direct (void);
+void reclaim_print_stats (void);
+
+#endif /* vm/reclaim.h */
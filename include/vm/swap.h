@@ -0,0 +1,26 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+#include <stddef.h>
+#include <stdint.h>
+
+struct disk;
+
+/* Swap slot of a page that is not on the swap disk. */
+#define SWAP_SLOT_NONE SIZE_MAX
+
+/* When swap_read() reads the slots after the one requested. */
+enum swap_readahead {
+	SWAP_RA_AUTO,               /* If reads so far have been sequential. */
+	SWAP_RA_NEVER,              /* Never. */
+	SWAP_RA_ALWAYS,             /* Always. */
+};
+
+void swap_init (struct disk *disk);
+size_t swap_alloc (void);
+void swap_write (size_t slot, const void *kva, unsigned ref_cnt);
+void swap_read (size_t slot, void *kva, enum swap_readahead ra_mode);
+void swap_ref (size_t slot);
+void swap_free (size_t slot);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */
@@ -1,6 +1,9 @@
 #ifndef VM_VM_H
 #define VM_VM_H
+#include <hash.h>
+#include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "threads/palloc.h"
 
 enum vm_type {
@@ -46,6 +49,10 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	bool writable;         /* May the user process write this page? */
+	struct thread *owner;  /* Process whose address space holds the page. */
+	struct list_elem frame_elem;  /* Element in frame's `pages' list. */
+	unsigned char advice;  /* Access pattern hint, MADV_* from madvise(). */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -59,10 +66,25 @@ struct page {
 	};
 };
 
-/* The representation of "frame" */
+/* The representation of "frame".
+ * A frame is normally mapped by a single page.  After fork(), parent and
+ * child share their anonymous frames copy-on-write, and same-page merging
+ * (ksm.c) makes identical anonymous pages share one frame the same way:
+ * every page on PAGES maps the frame read-only until vm_handle_wp() gives
+ * the writer a copy. */
 struct frame {
 	void *kva;
-	struct page *page;
+	struct list pages;     /* Pages mapping this frame. */
+	unsigned pin_cnt;      /* Exempt from eviction while nonzero. */
+	uint64_t checksum;     /* Contents hash at the last merging scan. */
+	bool merged;           /* Shared as a result of same-page merging. */
+	bool writeback;        /* Being written out without the frame lock. */
+
+	/* File range held, while in the shared text table (file.c). */
+	struct hash_elem text_elem;
+	struct inode *text_inode;
+	off_t text_ofs;
+	size_t text_bytes;
 };
 
 /* The function table for page operations.
@@ -82,11 +104,41 @@ struct page_operations {
 	if ((page)->operations->destroy) (page)->operations->destroy (page)
 
 /* Representation of current process's memory space.
- * We don't want to force you to obey any specific design for this struct.
- * All designs up to you for this. */
+ *
+ * The table is a 4-level radix tree keyed by user virtual address that has
+ * the same shape as the x86-64 page table: each level consumes 9 bits of
+ * the address (PML4, PDPE, PDX and PTX, see pte.h) and every node is a
+ * single page of SPT_FANOUT slots.  The leaves hold `struct page *'.
+ * Nodes are allocated on first insert below them, so an address space only
+ * pays for the regions it actually uses. */
+#define SPT_LEVELS 4
+#define SPT_FANOUT 512
+
+struct spt_node {
+	void *slots[SPT_FANOUT];    /* Child nodes, or pages at the last level. */
+};
+
 struct supplemental_page_table {
+	struct spt_node *root;      /* PML4-level node, NULL while empty. */
+};
+
+/* Paging statistics of one process.  Every fault resolved is either
+ * minor, needing no I/O, or major; copy-on-write and stack-growth faults
+ * are counted again on their own.  RSS is the number of frames the
+ * process maps, shared ones included. */
+struct vm_stats {
+	long long minor_faults;     /* Faults resolved without I/O. */
+	long long major_faults;     /* Faults that read from a file or swap. */
+	long long cow_faults;       /* Writes to a shared frame. */
+	long long stack_faults;     /* Faults that grew the stack. */
+	long long swap_ins;         /* Pages read back from swap. */
+	size_t rss;                 /* Frames mapped now. */
+	size_t peak_rss;            /* Most frames ever mapped at once. */
 };
 
+/* Callback for spt_for_each_range().  Returning false stops the walk. */
+typedef bool spt_range_func (struct page *page, void *aux);
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
@@ -96,10 +148,46 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+bool spt_for_each_range (struct supplemental_page_table *spt,
+		void *start, void *end, spt_range_func *func, void *aux);
+bool spt_range_is_free (struct supplemental_page_table *spt,
+		void *start, void *end);
+
+/* Maximum size of the user stack. */
+#define USER_STACK_LIMIT (1 << 20)
+
+/* Largest fault-around window, in pages. */
+#define FAULT_AROUND_MAX 32
+extern size_t fault_around_pages;
+
+extern bool vm_exit_stats;
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
+bool vm_is_stack_access (void *addr, void *rsp);
+bool vm_filesys_lock (void);
+void vm_filesys_unlock (bool acquired);
+size_t vm_frame_cnt (void);
+size_t vm_free_frame_cnt (void);
+struct frame *vm_frame_at (size_t idx);
+bool vm_frame_lock (void);
+void vm_frame_unlock (bool acquired);
+struct page *vm_frame_page (struct frame *frame);
+void vm_frame_link (struct frame *frame, struct page *page);
+void vm_frame_unlink (struct page *page);
+bool vm_page_map (struct page *page, void *kva, bool writable);
+void vm_unmap_frame (struct page *page);
+void vm_free_frame (struct page *page);
+void vm_frame_release (struct frame *frame);
+void vm_writeback_begin (struct frame *frame);
+void vm_writeback_end (struct frame *frame);
+void vm_writeback_wait (struct page *page);
+bool vm_reclaim_frame (void);
+size_t vm_clean_frames (size_t scan_cnt);
+bool vm_reclaim_page (struct page *page);
+bool vm_madvise (void *addr, size_t length, int advice);
+void vm_print_process_stats (void);
 
 #define vm_alloc_page(type, upage, writable) \
 	vm_alloc_page_with_initializer ((type), (upage), (writable), NULL, NULL)
@@ -0,0 +1,24 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Size of the compressed swap cache in pages, 0 to disable it.
+   Controlled by kernel command-line option "-zswap=PAGES". */
+extern size_t zswap_pages;
+
+/* Writes the page at KVA to swap slot SLOT on disk. */
+typedef void zswap_writeback_func (size_t slot, const void *kva);
+
+void zswap_init (size_t slot_cnt, zswap_writeback_func *writeback);
+bool zswap_store (size_t slot, const void *kva, struct list *victims);
+size_t zswap_victim_slot (struct list_elem *);
+void zswap_write_victims (struct list *victims);
+size_t zswap_victim_done (struct list_elem *);
+bool zswap_load (size_t slot, void *kva);
+bool zswap_contains (size_t slot);
+void zswap_forget (size_t slot);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */
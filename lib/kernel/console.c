@@ -1,114 +1,287 @@
 #include <console.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/serial.h"
 #include "devices/vga.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Console output goes through the kernel log, a ring buffer of
+   everything written to the console.  Writers only copy their
+   output into the log, with interrupts off for as long as that
+   takes, so printf() never waits for the vga or serial devices.
+   The klogd thread later copies the log out to the devices.
+
+   Each printf() call of up to PRINTF_CHUNK bytes, and each putbuf()
+   call that fits in the log, is added to the log in one piece, so
+   output of different threads is not mixed up.  Longer output may
+   be interleaved with other threads' output.
+
+   A writer that finds the log full of bytes not yet output copies
+   them out itself, unless it is an interrupt handler or is already
+   doing so, in which case its output is dropped.  Before klogd
+   starts, and after a kernel panic, every writer copies the log out
+   right away, as the console used to; after a panic this includes
+   interrupt handlers.  klogd is only started in
+   kernels with user programs, so in the threads project every
+   writer copies its own output out.
+
+   The log keeps the latest LOG_SIZE bytes of output after they have
+   been written out, for the dmesg() system call. */
 
 static void vprintf_helper (char, void *);
-static void putchar_have_lock (uint8_t c);
+static void log_write (const char *, size_t);
+static void log_drain (void);
 
-/* The console lock.
-   Both the vga and serial layers do their own locking, so it's
-   safe to call them at any time.
-   But this lock is useful to prevent simultaneous printf() calls
-   from mixing their output, which looks confusing. */
-static struct lock console_lock;
+/* Size of the log, a power of 2. */
+#define LOG_SIZE 16384
 
-/* True in ordinary circumstances: we want to use the console
-   lock to avoid mixing output between threads, as explained
-   above.
+/* The log.  Byte I of all output ever written is at LOG[I % LOG_SIZE]
+   until it is overwritten.  Bytes [LOG_OUT, LOG_HEAD) have yet to be
+   output to the devices.  Interrupts must be off to change these. */
+static char log_buf[LOG_SIZE];
+static uint64_t log_head;
+static uint64_t log_out;
+
+/* Held while copying bytes out of the log to the devices, so that
+   they come out in order. */
+static struct lock drain_lock;
+
+/* True in ordinary circumstances: the log is drained under
+   drain_lock, as explained above.
 
    False in early boot before the point that locks are functional
-   or the console lock has been initialized, or after a kernel
-   panics.  In the former case, taking the lock would cause an
-   assertion failure, which in turn would cause a panic, turning
-   it into the latter case.  In the latter case, if it is a buggy
-   lock_acquire() implementation that caused the panic, we'll
-   likely just recurse. */
-static bool use_console_lock;
-
-/* It's possible, if you add enough debug output to Pintos, to
-   try to recursively grab console_lock from a single thread.  As
-   a real example, I added a printf() call to palloc_free().
-   Here's a real backtrace that resulted:
-
-   lock_console()
-   vprintf()
-   printf()             - palloc() tries to grab the lock again
-   palloc_free()        
-   schedule_tail()      - another thread dying as we switch threads
-   schedule()
-   thread_yield()
-   intr_handler()       - timer interrupt
-   intr_set_level()
-   serial_putc()
-   putchar_have_lock()
-   putbuf()
-   sys_write()          - one process writing to the console
-   syscall_handler()
-   intr_handler()
-
-   This kind of thing is very difficult to debug, so we avoid the
-   problem by simulating a recursive lock with a depth
-   counter. */
-static int console_lock_depth;
+   or the lock has been initialized, or after a kernel panics.  In
+   the former case, taking the lock would cause an assertion
+   failure, which in turn would cause a panic, turning it into the
+   latter case.  In the latter case, if it is a buggy lock_acquire()
+   implementation that caused the panic, we'll likely just recurse. */
+static bool use_drain_lock;
+
+/* The thread that drains the log, once started, and whether it is
+   blocked waiting for output. */
+static struct thread *klogd;
+static bool klogd_sleeping;
+
+/* Bytes added to a printf() call's output before it is written to
+   the log. */
+#define PRINTF_CHUNK 128
+
+/* Output of one vprintf() call being formatted. */
+struct vprintf_aux {
+	char buf[PRINTF_CHUNK];     /* Bytes not yet in the log. */
+	size_t len;                 /* Number of bytes in BUF. */
+	int char_cnt;               /* Number of bytes formatted. */
+};
 
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
+/* Number of characters dropped because the log was full. */
+static int64_t drop_cnt;
+
 /* Enable console locking. */
 void
 console_init (void) {
-	lock_init (&console_lock);
-	use_console_lock = true;
+	lock_init (&drain_lock);
+	use_drain_lock = true;
+}
+
+/* Thread function for klogd. */
+static void
+klogd_thread (void *aux UNUSED) {
+	enum intr_level old_level = intr_disable ();
+	klogd = thread_current ();
+	intr_set_level (old_level);
+
+	for (;;) {
+		log_drain ();
+
+		old_level = intr_disable ();
+		if (log_out == log_head) {
+			klogd_sleeping = true;
+			thread_block ();
+		}
+		intr_set_level (old_level);
+	}
+}
+
+/* Starts klogd, so that console output is no longer written out by the
+   threads that produce it.  Must be called after thread_start(). */
+void
+console_start (void) {
+	thread_create ("klogd", PRI_DEFAULT, klogd_thread, NULL);
 }
 
 /* Notifies the console that a kernel panic is underway,
-   which warns it to avoid trying to take the console lock from
-   now on. */
+   which warns it to avoid trying to take the drain lock from
+   now on, and to write everything out right away. */
 void
 console_panic (void) {
-	use_console_lock = false;
+	use_drain_lock = false;
+}
+
+/* Writes everything in the log to the devices, and waits for the
+   serial port to send it. */
+void
+console_flush (void) {
+	log_drain ();
+	serial_flush ();
 }
 
 /* Prints console statistics. */
 void
 console_print_stats (void) {
 	printf ("Console: %lld characters output\n", write_cnt);
+	if (drop_cnt != 0)
+		printf ("Console: %lld characters dropped\n", drop_cnt);
+}
+
+/* Returns the number of bytes ever written to the log. */
+uint64_t
+console_log_size (void) {
+	enum intr_level old_level = intr_disable ();
+	uint64_t size = log_head;
+	intr_set_level (old_level);
+	return size;
+}
+
+/* Copies up to SIZE bytes of the log into BUF, starting at byte *POS
+   of all output ever written, and advances *POS past them.  If that
+   byte has been overwritten, starts at the oldest byte still in the
+   log instead.  Returns the number of bytes copied. */
+size_t
+console_log_read (uint64_t *pos, char *buf, size_t size) {
+	enum intr_level old_level = intr_disable ();
+	size_t copied = 0;
+
+	if (log_head > LOG_SIZE && *pos < log_head - LOG_SIZE)
+		*pos = log_head - LOG_SIZE;
+	while (copied < size && *pos < log_head) {
+		size_t ofs = *pos % LOG_SIZE;
+		size_t n = LOG_SIZE - ofs;
+
+		if (n > log_head - *pos)
+			n = log_head - *pos;
+		if (n > size - copied)
+			n = size - copied;
+		memcpy (buf + copied, log_buf + ofs, n);
+		copied += n;
+		*pos += n;
+	}
+	intr_set_level (old_level);
+	return copied;
 }
 
-/* Acquires the console lock. */
-	static void
-acquire_console (void) {
-	if (!intr_context () && use_console_lock) {
-		if (lock_held_by_current_thread (&console_lock)) 
-			console_lock_depth++; 
-		else
-			lock_acquire (&console_lock); 
+/* Returns true if the caller may drain the log itself.  Without
+   drain_lock, in early boot or after a panic, anyone may, even an
+   interrupt handler: serial_write() polls when it cannot queue, so
+   a panic in an interrupt handler still gets printed. */
+static bool
+may_drain (void) {
+	if (!use_drain_lock)
+		return true;
+	return !intr_context () && !lock_held_by_current_thread (&drain_lock);
+}
+
+/* Writes the bytes in the log that have not been output to the vga
+   display and serial port.  Does nothing if the caller is already
+   doing so further up its stack, which happens if the devices print
+   something. */
+static void
+log_drain (void) {
+	if (!may_drain ())
+		return;
+	if (use_drain_lock)
+		lock_acquire (&drain_lock);
+
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		uint64_t out = log_out;
+		size_t ofs = out % LOG_SIZE;
+		size_t n = LOG_SIZE - ofs;
+
+		if (n > log_head - out)
+			n = log_head - out;
+		intr_set_level (old_level);
+		if (n == 0)
+			break;
+
+		/* Nobody else drains while we hold the lock, and writers
+		   do not overwrite bytes before LOG_OUT, so the bytes
+		   stay put while we write them out. */
+		serial_write (log_buf + ofs, n);
+		for (size_t i = 0; i < n; i++)
+			vga_putc (log_buf[ofs + i]);
+
+		old_level = intr_disable ();
+		log_out = out + n;
+		intr_set_level (old_level);
 	}
+
+	if (use_drain_lock)
+		lock_release (&drain_lock);
 }
 
-/* Releases the console lock. */
+/* Wakes klogd if it is waiting for output. */
 static void
-release_console (void) {
-	if (!intr_context () && use_console_lock) {
-		if (console_lock_depth > 0)
-			console_lock_depth--;
-		else
-			lock_release (&console_lock); 
+klogd_wake (void) {
+	enum intr_level old_level = intr_disable ();
+	if (klogd_sleeping) {
+		klogd_sleeping = false;
+		thread_unblock (klogd);
 	}
+	intr_set_level (old_level);
 }
 
-/* Returns true if the current thread has the console lock,
-   false otherwise. */
-static bool
-console_locked_by_current_thread (void) {
-	return (intr_context ()
-			|| !use_console_lock
-			|| lock_held_by_current_thread (&console_lock));
+/* Adds the N bytes in BUF to the log and arranges for them to be
+   output. */
+static void
+log_write (const char *buf, size_t n) {
+	enum intr_level old_level = intr_disable ();
+
+	write_cnt += n;
+	while (n > 0) {
+		size_t room = LOG_SIZE - (log_head - log_out);
+
+		if (room == 0) {
+			/* The log is full of bytes that have yet to be output.
+			   Output them ourselves if we can; otherwise, drop the
+			   rest. */
+			if (!may_drain ()) {
+				drop_cnt += n;
+				break;
+			}
+			intr_set_level (old_level);
+			log_drain ();
+			old_level = intr_disable ();
+			continue;
+		}
+
+		while (n > 0 && room > 0) {
+			size_t ofs = log_head % LOG_SIZE;
+			size_t chunk = LOG_SIZE - ofs;
+
+			if (chunk > room)
+				chunk = room;
+			if (chunk > n)
+				chunk = n;
+			memcpy (log_buf + ofs, buf, chunk);
+			log_head += chunk;
+			buf += chunk;
+			n -= chunk;
+			room -= chunk;
+		}
+	}
+	intr_set_level (old_level);
+
+	if (klogd != NULL && use_drain_lock)
+		klogd_wake ();
+	else
+		log_drain ();
 }
 
 /* The standard vprintf() function,
@@ -116,24 +289,32 @@ console_locked_by_current_thread (void) {
    Writes its output to both vga display and serial port. */
 int
 vprintf (const char *format, va_list args) {
-	int char_cnt = 0;
+	struct vprintf_aux aux;
 
-	acquire_console ();
-	__vprintf (format, args, vprintf_helper, &char_cnt);
-	release_console ();
+	aux.len = 0;
+	aux.char_cnt = 0;
+	__vprintf (format, args, vprintf_helper, &aux);
+	log_write (aux.buf, aux.len);
 
-	return char_cnt;
+	return aux.char_cnt;
 }
 
 /* Writes string S to the console, followed by a new-line
    character. */
 int
 puts (const char *s) {
-	acquire_console ();
-	while (*s != '\0')
-		putchar_have_lock (*s++);
-	putchar_have_lock ('\n');
-	release_console ();
+	size_t len = strlen (s);
+
+	if (len < PRINTF_CHUNK) {
+		char line[PRINTF_CHUNK];
+
+		memcpy (line, s, len);
+		line[len] = '\n';
+		log_write (line, len + 1);
+	} else {
+		log_write (s, len);
+		log_write ("\n", 1);
+	}
 
 	return 0;
 }
@@ -141,37 +322,28 @@ puts (const char *s) {
 /* Writes the N characters in BUFFER to the console. */
 void
 putbuf (const char *buffer, size_t n) {
-	acquire_console ();
-	while (n-- > 0)
-		putchar_have_lock (*buffer++);
-	release_console ();
+	log_write (buffer, n);
 }
 
 /* Writes C to the vga display and serial port. */
 int
 putchar (int c) {
-	acquire_console ();
-	putchar_have_lock (c);
-	release_console ();
+	char ch = c;
+
+	log_write (&ch, 1);
 
 	return c;
 }
-
+
 /* Helper function for vprintf(). */
 static void
-vprintf_helper (char c, void *char_cnt_) {
-	int *char_cnt = char_cnt_;
-	(*char_cnt)++;
-	putchar_have_lock (c);
-}
+vprintf_helper (char c, void *aux_) {
+	struct vprintf_aux *aux = aux_;
 
-/* Writes C to the vga display and serial port.
-   The caller has already acquired the console lock if
-   appropriate. */
-static void
-putchar_have_lock (uint8_t c) {
-	ASSERT (console_locked_by_current_thread ());
-	write_cnt++;
-	serial_putc (c);
-	vga_putc (c);
+	aux->char_cnt++;
+	if (aux->len == PRINTF_CHUNK) {
+		log_write (aux->buf, aux->len);
+		aux->len = 0;
+	}
+	aux->buf[aux->len++] = c;
 }
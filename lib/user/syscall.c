@@ -54,7 +54,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-		syscall(((uint64_t *) NUMBER), \
+		syscall(((uint64_t) NUMBER), \
 			((uint64_t) ARG0), \
 			((uint64_t) ARG1), \
 			((uint64_t) ARG2), \
@@ -155,6 +155,73 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+bool
+vmstat (struct vmstat *st) {
+	return syscall1 (SYS_VMSTAT, st);
+}
+
+pid_t
+spawn (const char *cmd_line, const int *fd_map, size_t fd_cnt) {
+	return (pid_t) syscall3 (SYS_SPAWN, cmd_line, fd_map, fd_cnt);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+ring_enter (struct io_ring *ring, unsigned to_submit) {
+	return syscall2 (SYS_RING_ENTER, ring, to_submit);
+}
+
+int
+copy_file_range (int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+		size_t length) {
+	return syscall5 (SYS_COPY_FILE_RANGE, fd_in, off_in, fd_out, off_out,
+			length);
+}
+
+bool
+sysstat (int syscall_nr, bool system_wide, struct sysstat *st) {
+	return syscall3 (SYS_SYSSTAT, syscall_nr, system_wide, st);
+}
+
+int
+dmesg (char *buffer, unsigned length) {
+	return syscall2 (SYS_DMESG, buffer, length);
+}
+
+int
+ttymode (int mode) {
+	return syscall1 (SYS_TTYMODE, mode);
+}
+
+int
+pipe (int fds[2]) {
+	return syscall1 (SYS_PIPE, fds);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
@@ -0,0 +1,50 @@
+/* Copies ranges between two files with copy_file_range(): from explicit
+   offsets, from the files' own positions, and a range that runs past the
+   end of the source, which copies only what is there. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char text[] = "abcdefghijklmnopqrstuvwxyz";
+  static const char expected[] = "fghijklmnoabcwxyz";
+  char buf[32];
+  off_t off_in, off_out;
+  int src, dst;
+
+  CHECK (create ("src.txt", sizeof text - 1), "create \"src.txt\"");
+  CHECK (create ("dst.txt", sizeof expected - 1), "create \"dst.txt\"");
+  CHECK ((src = open ("src.txt")) > 1, "open \"src.txt\"");
+  CHECK ((dst = open ("dst.txt")) > 1, "open \"dst.txt\"");
+  CHECK (write (src, text, sizeof text - 1) == sizeof text - 1,
+         "write \"src.txt\"");
+
+  off_in = 5;
+  off_out = 0;
+  CHECK (copy_file_range (src, &off_in, dst, &off_out, 10) == 10,
+         "copy 10 bytes from offset 5");
+  CHECK (off_in == 15 && off_out == 10, "offsets advanced");
+
+  seek (src, 0);
+  seek (dst, 10);
+  CHECK (copy_file_range (src, NULL, dst, NULL, 3) == 3,
+         "copy 3 bytes at the file positions");
+  CHECK (tell (src) == 3 && tell (dst) == 13, "positions advanced");
+
+  off_in = sizeof text - 1 - 4;
+  CHECK (copy_file_range (src, &off_in, dst, NULL, 100) == 4,
+         "copy past end of file");
+  CHECK (off_in == sizeof text - 1, "offset at end of file");
+
+  seek (dst, 0);
+  CHECK (read (dst, buf, sizeof buf) == sizeof expected - 1,
+         "read \"dst.txt\"");
+  if (memcmp (buf, expected, sizeof expected - 1))
+    fail ("copy_file_range() copied the wrong bytes");
+  close (src);
+  close (dst);
+}
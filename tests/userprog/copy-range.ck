@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range) begin
+(copy-range) create "src.txt"
+(copy-range) create "dst.txt"
+(copy-range) open "src.txt"
+(copy-range) open "dst.txt"
+(copy-range) write "src.txt"
+(copy-range) copy 10 bytes from offset 5
+(copy-range) offsets advanced
+(copy-range) copy 3 bytes at the file positions
+(copy-range) positions advanced
+(copy-range) copy past end of file
+(copy-range) offset at end of file
+(copy-range) read "dst.txt"
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
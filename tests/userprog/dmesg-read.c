@@ -0,0 +1,24 @@
+/* Writes a line to the console and checks that dmesg() finds it at
+   the end of the kernel log. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[512];
+
+void
+test_main (void) 
+{
+  static const char line[] = "(dmesg-read) marker\n";
+  int n;
+
+  msg ("marker");
+  n = dmesg (buf, sizeof buf - 1);
+  CHECK (n > 0 && n < (int) sizeof buf, "dmesg()");
+  buf[n] = '\0';
+  if (strstr (buf, line) == NULL)
+    fail ("marker not in kernel log");
+  CHECK (dmesg (buf, 4) == 4, "dmesg() of 4 bytes");
+}
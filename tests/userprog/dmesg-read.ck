@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dmesg-read) begin
+(dmesg-read) marker
+(dmesg-read) dmesg()
+(dmesg-read) dmesg() of 4 bytes
+(dmesg-read) end
+dmesg-read: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Opens and closes a file many more times than a process may have
+   files open at once, checking that each open() reuses the lowest
+   descriptor that has been closed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int h1, h2, h;
+  int i;
+
+  CHECK ((h1 = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((h2 = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  close (h1);
+  for (i = 0; i < 2000; i++)
+    {
+      h = open ("sample.txt");
+      if (h != h1)
+        fail ("open() #%d returned %d instead of %d", i, h, h1);
+      close (h);
+    }
+  msg ("reopened 2000 times");
+  close (h2);
+}
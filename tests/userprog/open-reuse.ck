@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-reuse) begin
+(open-reuse) open "sample.txt"
+(open-reuse) open "sample.txt" again
+(open-reuse) reopened 2000 times
+(open-reuse) end
+open-reuse: exit(0)
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Creates a pipe and forks.  The child moves the write end onto
+   its standard output with dup2() and writes a line, which the
+   parent reads from the other end until end of file. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static const char line[] = "through the pipe\n";
+static char buf[64];
+
+void
+test_main (void) 
+{
+  int fds[2];
+  pid_t pid;
+  int n, total = 0;
+
+  CHECK (pipe (fds) == 0, "pipe()");
+  CHECK (fds[0] > 1 && fds[1] > 1 && fds[0] != fds[1], "distinct descriptors");
+
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      close (fds[0]);
+      if (dup2 (fds[1], STDOUT_FILENO) != STDOUT_FILENO)
+        exit (1);
+      close (fds[1]);
+      write (STDOUT_FILENO, line, sizeof line - 1);
+      exit (0);
+    }
+
+  close (fds[1]);
+  while ((n = read (fds[0], buf + total, sizeof buf - 1 - total)) > 0)
+    total += n;
+  CHECK (n == 0, "end of file");
+  buf[total] = '\0';
+  if (strcmp (buf, line))
+    fail ("read \"%s\" instead of \"%s\"", buf, line);
+  msg ("read %d bytes", total);
+  CHECK (wait (pid) == 0, "wait for child");
+  close (fds[0]);
+}
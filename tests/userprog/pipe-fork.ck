@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-fork) begin
+(pipe-fork) pipe()
+(pipe-fork) distinct descriptors
+child: exit(0)
+(pipe-fork) end of file
+(pipe-fork) read 17 bytes
+(pipe-fork) wait for child
+(pipe-fork) end
+pipe-fork: exit(0)
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Reads and overwrites parts of a file with pread() and pwrite() and
+   checks that they use the offsets given and leave the file position
+   alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char text[] = "0123456789abcdefghij";
+  static const char expected[] = "0123456789abcdeXYZij";
+  char buf[32];
+  int handle;
+
+  CHECK (create ("data.txt", sizeof text - 1), "create \"data.txt\"");
+  CHECK ((handle = open ("data.txt")) > 1, "open \"data.txt\"");
+  CHECK (write (handle, text, sizeof text - 1) == sizeof text - 1,
+         "write \"data.txt\"");
+  seek (handle, 3);
+
+  CHECK (pread (handle, buf, 5, 10) == 5, "pread 5 bytes at offset 10");
+  if (memcmp (buf, text + 10, 5))
+    fail ("pread() read the wrong bytes");
+  CHECK (tell (handle) == 3, "tell after pread");
+
+  CHECK (pwrite (handle, "XYZ", 3, 15) == 3, "pwrite 3 bytes at offset 15");
+  CHECK (tell (handle) == 3, "tell after pwrite");
+
+  CHECK (pread (handle, buf, 8, 16) == 4, "pread past end of file");
+  CHECK (tell (handle) == 3, "tell after short pread");
+
+  seek (handle, 0);
+  CHECK (read (handle, buf, sizeof buf) == sizeof expected - 1,
+         "read \"data.txt\"");
+  if (memcmp (buf, expected, sizeof expected - 1))
+    fail ("pwrite() wrote the wrong bytes");
+  close (handle);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "data.txt"
+(pread-pwrite) open "data.txt"
+(pread-pwrite) write "data.txt"
+(pread-pwrite) pread 5 bytes at offset 10
+(pread-pwrite) tell after pread
+(pread-pwrite) pwrite 3 bytes at offset 15
+(pread-pwrite) tell after pwrite
+(pread-pwrite) pread past end of file
+(pread-pwrite) tell after short pread
+(pread-pwrite) read "data.txt"
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,66 @@
+/* Queues an open, then two writes, a read and a close in the
+   submission ring of an io_ring, and reaps their completions. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct ring_sqe sqes[8];
+static struct ring_cqe cqes[8];
+static struct io_ring ring = { .mask = 7, .sqes = sqes, .cqes = cqes };
+
+/* Queues a request and returns it. */
+static struct ring_sqe *
+queue (int opcode, int fd, void *addr, unsigned len, off_t offset)
+{
+  struct ring_sqe *sqe = &sqes[ring.sq_tail & ring.mask];
+
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = addr;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = ring.sq_tail;
+  ring.sq_tail++;
+  return sqe;
+}
+
+/* Reaps the next completion and returns its result. */
+static int
+reap (void)
+{
+  struct ring_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("completion ring is empty");
+  cqe = &cqes[ring.cq_head & ring.mask];
+  if (cqe->user_data != ring.cq_head)
+    fail ("completion %u is for request %u",
+          ring.cq_head, (unsigned) cqe->user_data);
+  ring.cq_head++;
+  return cqe->res;
+}
+
+void
+test_main (void) 
+{
+  char buf[13];
+  int fd;
+
+  CHECK (create ("ring.txt", 12), "create \"ring.txt\"");
+  queue (RING_OP_OPEN, 0, "ring.txt", 0, 0);
+  msg ("ring_enter() = %d", ring_enter (&ring, 1));
+  CHECK ((fd = reap ()) > 1, "open \"ring.txt\"");
+
+  memset (buf, 0, sizeof buf);
+  queue (RING_OP_WRITE, fd, "world!", 6, 6);
+  queue (RING_OP_WRITE, fd, "hello ", 6, 0);
+  queue (RING_OP_READ, fd, buf, 12, 0);
+  queue (RING_OP_CLOSE, fd, NULL, 0, 0);
+  msg ("ring_enter() = %d", ring_enter (&ring, 4));
+  msg ("write = %d", reap ());
+  msg ("write = %d", reap ());
+  msg ("read = %d: \"%s\"", reap (), buf);
+  msg ("close = %d", reap ());
+}
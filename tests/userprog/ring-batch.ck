@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-batch) begin
+(ring-batch) create "ring.txt"
+(ring-batch) ring_enter() = 1
+(ring-batch) open "ring.txt"
+(ring-batch) ring_enter() = 4
+(ring-batch) write = 6
+(ring-batch) write = 6
+(ring-batch) read = 12: "hello world!"
+(ring-batch) close = 0
+(ring-batch) end
+ring-batch: exit(0)
+EOF
+pass;
@@ -0,0 +1,17 @@
+/* Spawns a child process without forking and waits for it, then
+   checks that spawning a missing program fails. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t pid;
+
+  CHECK ((pid = spawn ("child-simple", NULL, 0)) != PID_ERROR,
+         "spawn(\"child-simple\")");
+  msg ("wait(spawn()) = %d", wait (pid));
+  msg ("spawn(\"no-such-file\") = %d", spawn ("no-such-file", NULL, 0));
+}
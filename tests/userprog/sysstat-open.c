@@ -0,0 +1,34 @@
+/* Checks that sysstat() counts this process's open() calls, their
+   failures and their latencies, and that the system-wide statistics
+   include them. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static long long
+returned (const struct sysstat *st) 
+{
+  long long cnt = 0;
+  int i;
+
+  for (i = 0; i < SYSSTAT_BUCKETS; i++)
+    cnt += st->hist[i];
+  return cnt;
+}
+
+void
+test_main (void) 
+{
+  struct sysstat st, all;
+
+  CHECK (open ("sample.txt") > 1, "open \"sample.txt\"");
+  CHECK (open ("no-such-file") == -1, "open \"no-such-file\"");
+  CHECK (sysstat (SYS_OPEN, false, &st), "sysstat(SYS_OPEN)");
+  msg ("calls=%lld errors=%lld returned=%lld",
+       st.calls, st.errors, returned (&st));
+  CHECK (sysstat (SYS_OPEN, true, &all) && all.calls >= st.calls,
+         "system-wide calls include this process's");
+  CHECK (!sysstat (-1, false, &st), "sysstat(-1) fails");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sysstat-open) begin
+(sysstat-open) open "sample.txt"
+(sysstat-open) open "no-such-file"
+(sysstat-open) sysstat(SYS_OPEN)
+(sysstat-open) calls=2 errors=1 returned=2
+(sysstat-open) system-wide calls include this process's
+(sysstat-open) sysstat(-1) fails
+(sysstat-open) end
+sysstat-open: exit(0)
+EOF
+pass;
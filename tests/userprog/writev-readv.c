@@ -0,0 +1,41 @@
+/* Writes three buffers to a file with one writev(), then reads
+   them back into two differently sized buffers with one readv(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char text[] = "header|body of the record|trailer\n";
+  struct iovec out[3] = {
+    { (void *) text, 7 },
+    { (void *) (text + 7), 19 },
+    { (void *) (text + 26), 8 },
+  };
+  char head[10], tail[64];
+  struct iovec in[2] = {
+    { head, sizeof head },
+    { tail, sizeof tail },
+  };
+  int handle, bytes;
+
+  CHECK (create ("log.txt", sizeof text - 1), "create \"log.txt\"");
+  CHECK ((handle = open ("log.txt")) > 1, "open \"log.txt\"");
+  bytes = writev (handle, out, 3);
+  if (bytes != (int) sizeof text - 1)
+    fail ("writev() returned %d instead of %zu", bytes, sizeof text - 1);
+  msg ("writev() wrote %d bytes", bytes);
+
+  seek (handle, 0);
+  bytes = readv (handle, in, 2);
+  if (bytes != (int) sizeof text - 1)
+    fail ("readv() returned %d instead of %zu", bytes, sizeof text - 1);
+  if (memcmp (head, text, sizeof head)
+      || memcmp (tail, text + sizeof head, bytes - sizeof head))
+    fail ("readv() read back different data");
+  msg ("readv() read %d bytes", bytes);
+  close (handle);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(writev-readv) begin
+(writev-readv) create "log.txt"
+(writev-readv) open "log.txt"
+(writev-readv) writev() wrote 34 bytes
+(writev-readv) readv() read 34 bytes
+(writev-readv) end
+writev-readv: exit(0)
+EOF
+pass;
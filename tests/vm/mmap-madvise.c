@@ -0,0 +1,36 @@
+/* Maps a file with MAP_POPULATE and checks that madvise() hints keep
+   its contents intact and that bad ranges are rejected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  void *map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (actual, 4096, MAP_POPULATE, handle, 0))
+         != MAP_FAILED, "mmap \"sample.txt\" with MAP_POPULATE");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of populated mapping reported bad data");
+
+  CHECK (madvise (actual, 4096, MADV_SEQUENTIAL) == 0,
+         "madvise MADV_SEQUENTIAL");
+  CHECK (madvise (actual, 4096, MADV_DONTNEED) == 0, "madvise MADV_DONTNEED");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read after MADV_DONTNEED reported bad data");
+
+  CHECK (madvise (actual + 1, 4096, MADV_WILLNEED) == -1,
+         "madvise misaligned address (must return -1)");
+  CHECK (madvise (actual, 8192, MADV_WILLNEED) == -1,
+         "madvise unmapped page (must return -1)");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-madvise) begin
+(mmap-madvise) open "sample.txt"
+(mmap-madvise) mmap "sample.txt" with MAP_POPULATE
+(mmap-madvise) madvise MADV_SEQUENTIAL
+(mmap-madvise) madvise MADV_DONTNEED
+(mmap-madvise) madvise misaligned address (must return -1)
+(mmap-madvise) madvise unmapped page (must return -1)
+(mmap-madvise) end
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Grows the stack by PAGES pages and checks that vmstat() reports a
+   minor fault for each of them and that RSS and peak RSS grow by as
+   much. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 16
+
+static struct vmstat before, after;
+
+/* Touches every page of a stack buffer that spans PAGES pages beyond
+   the ones the stack already uses. */
+static void
+touch_stack (void)
+{
+  volatile char buf[(PAGES + 2) * PAGE_SIZE];
+
+  for (size_t i = 0; i < sizeof buf; i += PAGE_SIZE)
+    buf[i] = 1;
+}
+
+void
+test_main (void)
+{
+  CHECK (vmstat (&before), "vmstat before");
+  touch_stack ();
+  CHECK (vmstat (&after), "vmstat after");
+
+  if (after.minor_faults - before.minor_faults < PAGES)
+    fail ("%lld minor faults for %d new pages",
+          after.minor_faults - before.minor_faults, PAGES);
+  if (after.rss - before.rss < PAGES)
+    fail ("RSS grew by %lld for %d new pages", after.rss - before.rss, PAGES);
+  if (after.peak_rss < after.rss || after.peak_rss < before.peak_rss + PAGES)
+    fail ("peak RSS %lld after %lld, RSS %lld",
+          after.peak_rss, before.peak_rss, after.rss);
+  msg ("minor faults, RSS and peak RSS grew");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-vmstat) begin
+(page-vmstat) vmstat before
+(page-vmstat) vmstat after
+(page-vmstat) minor faults, RSS and peak RSS grew
+(page-vmstat) end
+EOF
+pass;
@@ -21,6 +21,7 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -31,6 +32,10 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/ksm.h"
+#include "vm/reclaim.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -38,6 +43,8 @@
 #include "filesys/fsutil.h"
 #endif
 
+#define CR0_WP 0x00010000      /* Write-Protect enable in kernel mode. */
+
 /* Page-map-level-4 with kernel mappings only. */
 uint64_t *base_pml4;
 
@@ -100,10 +107,15 @@ main (void) {
 #ifdef USERPROG
 	exception_init ();
 	syscall_init ();
+	process_exec_cache_init ();
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
 	serial_init_queue ();
+#ifdef USERPROG
+	/* Kept out of the threads project, whose tests count threads. */
+	console_start ();
+#endif
 	timer_calibrate ();
 
 #ifdef FILESYS
@@ -165,6 +177,11 @@ paging_init (uint64_t mem_end) {
 
 	// reload cr3
 	pml4_activate(0);
+	pcid_init ();
+
+	/* Make the kernel honor read-only mappings too, so that its writes to
+	   read-only or copy-on-write user pages fault (see usercopy.c). */
+	lcr0 (rcr0 () | CR0_WP);
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -226,6 +243,20 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+		else if (!strcmp (name, "-scstats"))
+			syscall_exit_stats = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-ksm"))
+			ksm_enabled = true;
+		else if (!strcmp (name, "-fa"))
+			fault_around_pages = atoi (value);
+		else if (!strcmp (name, "-vmstat"))
+			vm_exit_stats = true;
+		else if (!strcmp (name, "-noreclaim"))
+			reclaim_enabled = false;
+		else if (!strcmp (name, "-zswap"))
+			zswap_pages = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -328,6 +359,16 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -scstats           Print system call and exec cache statistics\n"
+			"                     at power off.\n"
+#endif
+#ifdef VM
+			"  -ksm               Merge identical anonymous pages.\n"
+			"  -fa=PAGES          Load up to PAGES file pages per fault.\n"
+			"  -vmstat            Print paging statistics of exiting processes\n"
+			"                     and at power off.\n"
+			"  -noreclaim         Do not reclaim pages in the background.\n"
+			"  -zswap=PAGES       Keep up to PAGES of compressed swap in memory.\n"
 #endif
 			);
 	power_off ();
@@ -345,6 +386,7 @@ power_off (void) {
 	print_stats ();
 
 	printf ("Powering off...\n");
+	console_flush ();
 	outw (0x604, 0x2000);               /* Poweroff command for qemu */
 	for (;;);
 }
@@ -361,5 +403,19 @@ print_stats (void) {
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
+	if (syscall_exit_stats) {
+		process_print_stats ();
+		syscall_print_stats ();
+	}
+#endif
+#ifdef VM
+	if (vm_exit_stats) {
+		swap_print_stats ();
+		reclaim_print_stats ();
+	}
+	if (zswap_pages > 0)
+		zswap_print_stats ();
+	if (ksm_enabled)
+		ksm_print_stats ();
 #endif
 }
@@ -8,6 +8,86 @@
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers.
+ *
+ * Without PCIDs, every CR3 load flushes the TLB.  With them, TLB entries
+ * are tagged with the PCID in the low bits of CR3, so switching between
+ * processes keeps each one's entries.  PCID 0 belongs to base_pml4, and a
+ * process's pml4 gets the PCID its physical address hashes to.  If two
+ * pml4s hash to the same PCID, the one activated last takes it over and
+ * flushes the entries the other left behind.
+ *
+ * Entries of a pml4 that is not active stay in the TLB, so changing its
+ * page table must invalidate them too: with INVPCID, just the page's
+ * entry; without it, the pml4 gives up its PCID, so that activating it
+ * again starts with a flush. */
+#define CR4_PCIDE (1 << 17)         /* PCID enable. */
+#define CR3_PCID_MASK 0xfff         /* PCID bits of CR3. */
+#define CR3_NOFLUSH (1ULL << 63)    /* Keep the new PCID's entries. */
+#define PCID_CNT 4096
+
+#define CPUID_1_ECX_PCID (1 << 17)
+#define CPUID_7_EBX_INVPCID (1 << 10)
+
+static bool pcid_enabled;
+static bool invpcid_supported;
+
+/* The pml4 that each PCID currently tags entries for, if any. */
+static uint64_t *pcid_owner[PCID_CNT];
+
+/* Enables PCIDs if the CPU supports them.  Must be called while
+ * base_pml4, with PCID 0, is active. */
+void
+pcid_init (void) {
+	uint32_t regs[4];
+	uint32_t max_leaf;
+
+	cpuid (0, regs);
+	max_leaf = regs[0];
+	if (max_leaf < 1)
+		return;
+	cpuid (1, regs);
+	if (!(regs[2] & CPUID_1_ECX_PCID))
+		return;
+	if (max_leaf >= 7) {
+		cpuid (7, regs);
+		invpcid_supported = (regs[1] & CPUID_7_EBX_INVPCID) != 0;
+	}
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Returns the PCID that PML4 hashes to. */
+static uint64_t
+pcid_of (uint64_t *pml4) {
+	return (vtop (pml4) >> PGBITS) % (PCID_CNT - 1) + 1;
+}
+
+/* Returns true if PML4 is the page table in CR3. */
+static bool
+pml4_is_active (uint64_t *pml4) {
+	return (rcr3 () & ~(uint64_t) CR3_PCID_MASK) == vtop (pml4);
+}
+
+/* Flushes the TLB entry for user virtual page VA of PML4, wherever the
+ * TLB may hold one. */
+static void
+tlb_invalidate (uint64_t *pml4, const void *va) {
+	uint64_t pcid;
+
+	if (pml4_is_active (pml4))
+		invlpg ((uint64_t) va);
+	else if (pcid_enabled) {
+		pcid = pcid_of (pml4);
+		if (pcid_owner[pcid] != pml4)
+			return;
+		if (invpcid_supported)
+			invpcid (0, pcid, (uint64_t) va);
+		else
+			pcid_owner[pcid] = NULL;
+	}
+}
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
@@ -196,14 +276,38 @@ pml4_destroy (uint64_t *pml4) {
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
+
+	/* A pml4 allocated at the same address later must not inherit the
+	 * TLB entries tagged for this one. */
+	ASSERT (!pml4_is_active (pml4));
+	if (pcid_enabled && pcid_owner[pcid_of (pml4)] == pml4)
+		pcid_owner[pcid_of (pml4)] = NULL;
 	palloc_free_page ((void *) pml4);
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register, unless it is there already. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	uint64_t cr3;
+
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+	if (pml4_is_active (pml4))
+		return;
+
+	cr3 = vtop (pml4);
+	if (pcid_enabled && pml4 != base_pml4) {
+		uint64_t pcid = pcid_of (pml4);
+
+		if (pcid_owner[pcid] == pml4)
+			cr3 |= pcid | CR3_NOFLUSH;
+		else {
+			pcid_owner[pcid] = pml4;
+			cr3 |= pcid;
+		}
+	}
+	lcr3 (cr3);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -257,8 +361,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_invalidate (pml4, upage);
 	}
 }
 
@@ -283,8 +386,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -309,7 +411,6 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
@@ -328,6 +328,15 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Stores the first page of the user pool in *BASE and the number of
+   pages it spans in *PAGE_CNT.  Every page that palloc_get_page
+   (PAL_USER) can return lies in that range. */
+void
+palloc_user_pool_range (void **base, size_t *page_cnt) {
+	*base = user_pool.base;
+	*page_cnt = bitmap_size (user_pool.used_map);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -198,9 +198,6 @@ tid_t thread_create(const char *name, int priority,
    init_thread(t, name, priority); /* thread 구조체 초기화*/
    tid = t->tid = allocate_tid();  /* tid 할당 */
 
-   struct file **new_fdt = (struct file **)palloc_get_multiple(PAL_ZERO, 3);
-   t->fdt = new_fdt;
-
    /* Call the kernel_thread if it scheduled.
     * Note) rdi is 1st argument, and rsi is 2nd argument. */
    t->tf.rip = (uintptr_t)kernel_thread; /* 커널 스택 할당 */
@@ -514,7 +511,6 @@ init_thread(struct thread *t, const char *name, int priority)
    t->pre_priority = priority;
    t->wait_on_lock = NULL;
    t->exit_flag = 1;
-   t->next_fd = 2;
    list_init(&t->list_donation);
    list_init(&t->child_list);
    sema_init(&t->load_sema, 0);
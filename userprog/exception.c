@@ -7,6 +7,9 @@ exception.c, exception.h 파일들은 예외사항을 처리합니다. 현재 
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "userprog/syscall.h"
+#include "userprog/usercopy.h"
+#include "threads/vaddr.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -121,8 +124,8 @@ kill (struct intr_frame *f) {
    [IA32-v3a] section 5.15 "Exception and Interrupt Reference". */
 static void
 page_fault (struct intr_frame *f) {
-	bool not_present;  /* True: not-present page, false: writing r/o page. */
-	bool write;        /* True: access was write, false: access was read. */
+	bool not_present UNUSED; /* True: not-present page, false: writing r/o page. */
+	bool write UNUSED;       /* True: access was write, false: access was read. */
 	bool user;         /* True: access by user, false: access by kernel. */
 	void *fault_addr;  /* Fault address. */
 
@@ -142,7 +145,6 @@ page_fault (struct intr_frame *f) {
 	not_present = (f->error_code & PF_P) == 0;
 	write = (f->error_code & PF_W) != 0;
 	user = (f->error_code & PF_U) != 0;
-	exit(-1);
 
 #ifdef VM
 	/* For project 3 and later. */
@@ -150,15 +152,18 @@ page_fault (struct intr_frame *f) {
 		return;
 #endif
 
+	/* A bad user address passed to a system call makes the copy
+	   routine that touched it fail. */
+	if (!user && is_user_vaddr (fault_addr) && usercopy_fixup (f))
+		return;
+
 	/* Count page faults. */
 	page_fault_cnt++;
 
-	/* If the fault is true fault, show info and exit. */
-	printf ("Page fault at %p: %s error %s page in %s context.\n",
-			fault_addr,
-			not_present ? "not present" : "rights violation",
-			write ? "writing" : "reading",
-			user ? "user" : "kernel");
-	kill (f);
+	/* Any other bad user access kills the process.  System calls
+	   touch user memory only through the user copy routines, never
+	   while holding filesys_lock, so no fault leaves it held. */
+	ASSERT (!lock_held_by_current_thread (&filesys_lock));
+	exit(-1);
 }
 
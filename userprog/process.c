@@ -12,9 +12,11 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -30,10 +32,14 @@ static void process_cleanup(void);
 static bool load(const char *file_name, struct intr_frame *if_);
 static void initd(void *f_name);
 static void __do_fork(void *);
+static void __do_spawn(void *);
+static bool process_load(char *file_name, struct intr_frame *if_);
 void argument_stack(char **parse, int count, void **rsp);
 int process_add_file(struct file *f);
 struct file *process_get_file(int fd);
 void process_close_file(int fd);
+static bool fdt_install(struct thread *t, int fd, struct file *f);
+static bool fdt_copy(struct thread *dst, struct thread *src);
 void remove_child_process(struct thread *cp);
 struct thread *get_child_process(int pid);
 /* General process initializer for initd and other process. */
@@ -181,23 +187,9 @@ __do_fork(void *aux)
       goto error;
 #endif
 
-   if (parent->next_fd == FD_MAX)
+   if (!fdt_copy(current, parent))
       goto error;
-
-   for (int i = 0; i < FD_MAX; i++)
-   {
-      struct file *file = parent->fdt[i];
-      if (file == NULL)
-         continue;
-      struct file *new_file;
-      if (file > 2)
-         new_file = file_duplicate(file);
-      else
-         new_file = file;
-      current->fdt[i] = new_file;
-   }
    if_.R.rax = 0;
-   current->next_fd = parent->next_fd;
    process_init();
    sema_up(&current->load_sema);
    /* Finally, switch to the newly created process. */
@@ -208,6 +200,112 @@ error:
    sema_up(&current->load_sema);
    thread_exit();
 }
+/* Arguments passed to __do_spawn(). */
+struct spawn_info
+{
+   struct thread *parent; /* 부모 스레드 */
+   char *cmd_line;        /* 명령줄을 담은 페이지, 자식이 해제 */
+   const int *fd_map;     /* 자식 fd마다 대응하는 부모 fd, NULL이면 모두 상속 */
+   size_t fd_cnt;         /* fd_map의 길이 */
+};
+
+/* Starts a new process running CMD_LINE without duplicating the current
+ * one first, as fork() followed by exec() would.  If FD_MAP is null, the
+ * child inherits every open file like a forked child.  Otherwise fd I of
+ * the child, for FD_MIN <= I < FD_CNT, refers to the parent's fd
+ * FD_MAP[I], or is left closed if that is -1, and no other file is
+ * inherited.  Each fd in FD_MAP must be open in the parent.  Fds 0 and 1
+ * are always inherited, so the child writes to the console or, if the
+ * parent redirected them with dup2(), to the same files.  Returns the
+ * child's thread id once it has loaded, or TID_ERROR if it cannot be
+ * created or loaded. */
+tid_t process_spawn(const char *cmd_line, const int *fd_map, size_t fd_cnt)
+{
+   struct spawn_info info = {thread_current(), NULL, fd_map, fd_cnt};
+   char name[16];
+   char *prog, *save_ptr;
+   tid_t tid;
+
+   info.cmd_line = palloc_get_page(0);
+   if (info.cmd_line == NULL)
+      return TID_ERROR;
+   strlcpy(info.cmd_line, cmd_line, PGSIZE);
+
+   // 스레드 이름은 실행 파일 이름
+   strlcpy(name, cmd_line, sizeof name);
+   prog = strtok_r(name, " ", &save_ptr);
+   tid = prog != NULL ? thread_create(prog, PRI_DEFAULT, __do_spawn, &info)
+                      : TID_ERROR;
+   if (tid == TID_ERROR)
+   {
+      palloc_free_page(info.cmd_line);
+      return TID_ERROR;
+   }
+   struct thread *child = get_child_process(tid);
+
+   sema_down(&child->load_sema); // 자식이 load를 마칠 때까지 기다림(info는 그동안 유효)
+
+   if (child->exit_flag == -1)
+      return TID_ERROR;
+   return tid;
+}
+
+/* Installs a duplicate of F, a file of another process, in T's table as
+ * descriptor FD.  Returns false on failure. */
+static bool
+fdt_inherit(struct thread *t, int fd, struct file *f)
+{
+   struct file *file = file_duplicate(f);
+
+   if (file != NULL && fdt_install(t, fd, file))
+      return true;
+   file_close(file);
+   return false;
+}
+
+/* Thread function of a process created by process_spawn().  Unlike
+ * __do_fork(), it does not copy the parent's address space: it goes
+ * straight to loading the executable in a fresh page table. */
+static void
+__do_spawn(void *aux)
+{
+   struct spawn_info *info = aux;
+   struct thread *parent = info->parent;
+   struct thread *current = thread_current();
+   struct intr_frame if_;
+   bool success;
+
+   current->parent = parent;
+#ifdef VM
+   supplemental_page_table_init(&current->spt);
+#endif
+
+   /* 부모는 load_sema에서 기다리는 중이므로 부모의 fd 테이블을 읽어도 안전 */
+   if (info->fd_map == NULL)
+      success = fdt_copy(current, parent);
+   else
+   {
+      success = true;
+      // dup2로 바뀐 fd 0, 1도 그대로 상속 (비어 있으면 콘솔)
+      for (int fd = 0; success && fd < FD_MIN && fd < parent->fd_cap; fd++)
+         if (parent->fdt[fd] != NULL)
+            success = fdt_inherit(current, fd, parent->fdt[fd]);
+      for (size_t i = FD_MIN; success && i < info->fd_cnt; i++)
+         if (info->fd_map[i] >= 0)
+            success = fdt_inherit(current, i, parent->fdt[info->fd_map[i]]);
+   }
+   process_init();
+
+   success = success && process_load(info->cmd_line, &if_);
+   palloc_free_page(info->cmd_line);
+   if (!success)
+      current->exit_flag = TID_ERROR;
+   sema_up(&current->load_sema);
+   if (success)
+      do_iret(&if_);
+   thread_exit();
+}
+
 struct thread *get_child_process(int pid)
 {
    struct thread *par = thread_current();
@@ -232,17 +330,36 @@ int process_exec(void *f_name)
 {
    char *file_name = f_name;
    bool success;
-   struct thread *cur = thread_current();
-
-   // intr_frame 권한설정
    struct intr_frame _if;
-   _if.ds = _if.es = _if.ss = SEL_UDSEG;
-   _if.cs = SEL_UCSEG;
-   _if.eflags = FLAG_IF | FLAG_MBS;
 
    /* We first kill the current context */
    process_cleanup();
 
+   /* And then load the binary */
+   success = process_load(file_name, &_if);
+   palloc_free_page(file_name);
+
+   /* If load failed, quit. */
+   if (!success)
+      return -1;
+
+   /* Start switched process. */
+   do_iret(&_if);
+   NOT_REACHED();
+}
+
+/* Loads the program named by the first word of FILE_NAME into the current
+ * thread, which has no address space yet, with the remaining words as its
+ * arguments, and sets up IF_ to start it.  Modifies FILE_NAME.  Returns
+ * true if successful. */
+static bool
+process_load(char *file_name, struct intr_frame *if_)
+{
+   // intr_frame 권한설정
+   if_->ds = if_->es = if_->ss = SEL_UDSEG;
+   if_->cs = SEL_UCSEG;
+   if_->eflags = FLAG_IF | FLAG_MBS;
+
    // for argument parsing
    char *parse[64];
    int count = 0;
@@ -257,25 +374,13 @@ int process_exec(void *f_name)
       count++;
    }
 
-   /* And then load the binary */
-   success = load(file_name, &_if);
-
-   /* If load failed, quit. */
-   if (!success)
-   {
-      palloc_free_page(file_name);
-      return -1;
-   }
-
-   argument_stack(parse, count, &_if.rsp);
-   _if.R.rdi = count;
-   _if.R.rsi = _if.rsp + 8;
-
-   palloc_free_page(file_name);
+   if (!load(file_name, if_))
+      return false;
 
-   /* Start switched process. */
-   do_iret(&_if);
-   NOT_REACHED();
+   argument_stack(parse, count, &if_->rsp);
+   if_->R.rdi = count;
+   if_->R.rsi = if_->rsp + 8;
+   return true;
 }
 
 void argument_stack(char **parse, int count, void **rsp)
@@ -311,24 +416,122 @@ void argument_stack(char **parse, int count, void **rsp)
    **(void ***)rsp = 0;
 }
 
+/* File descriptor tables.
+ *
+ * A process gets its table when it first opens a file, so kernel threads
+ * never have one.  The table starts with FDT_INIT_CAP slots and doubles
+ * whenever a descriptor past the end is needed, up to FD_MAX.  A bitmap
+ * of the slots in use, one word per 64 descriptors, finds the lowest free
+ * descriptor a word at a time, so descriptors of closed files are handed
+ * out again first.  Descriptors 0 and 1 are the console and are never
+ * handed out, but dup2() can put a file in their slots, which then takes
+ * the console's place. */
+
+/* Number of slots in a new table. */
+#define FDT_INIT_CAP 64
+
+/* Grows T's table to at least CAP slots.  Returns false if CAP exceeds
+ * FD_MAX or memory runs out. */
+static bool
+fdt_grow(struct thread *t, int cap)
+{
+   int new_cap = t->fd_cap > 0 ? t->fd_cap : FDT_INIT_CAP;
+   struct file **fdt;
+   uint64_t *used;
+
+   if (cap > FD_MAX)
+      return false;
+   while (new_cap < cap)
+      new_cap *= 2;
+   if (new_cap > FD_MAX)
+      new_cap = FD_MAX;
+   if (new_cap <= t->fd_cap)
+      return true;
+
+   fdt = realloc(t->fdt, new_cap * sizeof *fdt);
+   if (fdt == NULL)
+      return false;
+   t->fdt = fdt;
+   used = realloc(t->fd_used, new_cap / 64 * sizeof *used);
+   if (used == NULL)
+      return false;
+   t->fd_used = used;
+   memset(fdt + t->fd_cap, 0, (new_cap - t->fd_cap) * sizeof *fdt);
+   memset(used + t->fd_cap / 64, 0, (new_cap - t->fd_cap) / 64 * sizeof *used);
+   t->fd_cap = new_cap;
+   return true;
+}
+
+/* Puts F in T's table as descriptor FD, which must be free.  Returns
+ * false if FD is out of range or the table cannot grow to hold it. */
+static bool
+fdt_install(struct thread *t, int fd, struct file *f)
+{
+   if (fd < 0 || (fd >= t->fd_cap && !fdt_grow(t, fd + 1)))
+      return false;
+   ASSERT(t->fdt[fd] == NULL);
+   t->fdt[fd] = f;
+   t->fd_used[fd / 64] |= 1ULL << (fd % 64);
+   return true;
+}
+
+/* Returns T's lowest free descriptor.  If every slot is taken this is
+ * the first one past the end of the table, which fdt_install() grows
+ * the table to hold. */
+static int
+fdt_lowest_free(struct thread *t)
+{
+   for (int w = 0; w < t->fd_cap / 64; w++)
+   {
+      /* 콘솔 fd 0, 1은 항상 사용 중으로 취급 */
+      uint64_t taken = t->fd_used[w] | (w == 0 ? (1ULL << FD_MIN) - 1 : 0);
+      if (taken != UINT64_MAX)
+         return w * 64 + __builtin_ctzll(~taken);
+   }
+   return t->fd_cap > FD_MIN ? t->fd_cap : FD_MIN;
+}
+
+/* Gives DST, whose table is empty, a copy of SRC's table with every file
+ * duplicated.  Descriptors that share a file in SRC, through dup2(), share
+ * its duplicate in DST.  Returns false on failure, leaving DST's table with
+ * the files copied so far for process_exit() to close. */
+static bool
+fdt_copy(struct thread *dst, struct thread *src)
+{
+   for (int fd = 0; fd < src->fd_cap; fd++)
+   {
+      struct file *file = NULL;
+
+      if (src->fdt[fd] == NULL)
+         continue;
+      for (int prev = 0; prev < fd && file == NULL; prev++)
+         if (src->fdt[prev] == src->fdt[fd])
+            file = file_dup(dst->fdt[prev]);
+      if (file == NULL)
+         file = file_duplicate(src->fdt[fd]);
+      if (file == NULL || !fdt_install(dst, fd, file))
+      {
+         file_close(file);
+         return false;
+      }
+   }
+   return true;
+}
+
+/* 파일 객체를 가장 작은 빈 File Descriptor에 추가하고 그 값을 반환.
+ * 테이블이 가득 찼으면 -1 */
 int process_add_file(struct file *f)
 {
    struct thread *cur = thread_current();
+   int fd = fdt_lowest_free(cur);
 
-   // 파일 객체(struct file)를 가리키는 포인터를 File Descriptor 테이블에 추가
-   lock_acquire(&filesys_lock);
-   cur->fdt[cur->next_fd] = f;
-   lock_release(&filesys_lock);
-   // 다음 File Descriptor 값 1 증가
-   cur->next_fd++;
-   // 추가된 파일 객체의 File Descriptor 반환
-   return cur->next_fd - 1;
+   return fdt_install(cur, fd, f) ? fd : -1;
 }
 
 struct file *process_get_file(int fd)
 {
    struct thread *cur = thread_current();
-   if (fd < FD_MIN || fd >= FD_MAX)
+   if (fd < 0 || fd >= cur->fd_cap)
    {
       return NULL;
    }
@@ -337,11 +540,36 @@ struct file *process_get_file(int fd)
 void process_close_file(int fd)
 {
    struct thread *cur = thread_current();
-   if (fd < FD_MIN || fd >= FD_MAX)
+   if (fd < 0 || fd >= cur->fd_cap)
    {
       return;
    }
    cur->fdt[fd] = NULL;
+   cur->fd_used[fd / 64] &= ~(1ULL << (fd % 64));
+}
+
+/* Makes NEWFD refer to the same file as OLDFD, closing the file NEWFD
+ * referred to first, and returns NEWFD.  NEWFD may be 0 or 1 to send the
+ * console's input or output to the file.  Returns -1 if OLDFD is not an
+ * open file or NEWFD is out of range. */
+int process_dup2(int oldfd, int newfd)
+{
+   struct thread *cur = thread_current();
+   struct file *file = process_get_file(oldfd);
+
+   if (file == NULL || newfd < 0 || newfd >= FD_MAX)
+      return -1;
+   if (oldfd == newfd)
+      return newfd;
+   if (newfd >= cur->fd_cap && !fdt_grow(cur, newfd + 1))
+      return -1;
+   if (cur->fdt[newfd] != NULL)
+   {
+      file_close(cur->fdt[newfd]);
+      process_close_file(newfd);
+   }
+   fdt_install(cur, newfd, file_dup(file));
+   return newfd;
 }
 void remove_child_process(struct thread *cp)
 {
@@ -376,8 +604,20 @@ int process_wait(tid_t child_tid UNUSED)
 void process_exit(void)
 {
    struct thread *cur = thread_current();
-   for (int i = 2; i < 64; i++)
-      close(i);
+#ifdef VM
+   if (vm_exit_stats && cur->pml4 != NULL)
+      vm_print_process_stats();
+#endif
+   for (int i = 0; i < cur->fd_cap; i++)
+      if (cur->fdt[i] != NULL)
+         close(i);
+   free(cur->fdt);
+   free(cur->fd_used);
+   cur->fdt = NULL;
+   cur->fd_used = NULL;
+   cur->fd_cap = 0;
+   free(cur->syscall_stats);
+   cur->syscall_stats = NULL;
    file_close(cur->running_file);
    sema_up(&cur->exit_sema);
    sema_down(&cur->free_sema);
@@ -417,8 +657,12 @@ process_cleanup(void)
  * This function is called on every context switch. */
 void process_activate(struct thread *next)
 {
-   /* Activate thread's page tables. */
-   pml4_activate(next->pml4);
+   /* Activate thread's page tables.  A kernel thread has none of its own
+    * and never touches user memory, so it keeps running on whichever
+    * page table is loaded: every one of them maps the kernel the same
+    * way, and the CPU keeps its TLB. */
+   if (next->pml4 != NULL)
+      pml4_activate(next->pml4);
 
    /* Set thread's kernel stack for use in processing interrupts. */
    tss_update(next);
@@ -485,48 +729,154 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
                          uint32_t read_bytes, uint32_t zero_bytes,
                          bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
- * Stores the executable's entry point into *RIP
- * and its initial stack pointer into *RSP.
- * Returns true if successful, false otherwise. */
-static bool
-load(const char *file_name, struct intr_frame *if_)
+/* A loadable segment of an executable, already checked by
+ * validate_segment() and laid out for load_segment(). */
+struct exec_segment
 {
-   struct thread *t = thread_current();
-   struct ELF ehdr;
-   struct file *file = NULL;
-   off_t file_ofs;
-   bool success = false;
-   int i;
+   uint64_t file_page;  /* Page-aligned offset in the file. */
+   uint64_t mem_page;   /* Page-aligned user virtual address. */
+   uint32_t read_bytes; /* Bytes to read from the file. */
+   uint32_t zero_bytes; /* Bytes to zero after them. */
+   bool writable;       /* Writable by the user process? */
+};
 
-   /* Allocate and activate page directory. */
-   t->pml4 = pml4_create();
-   if (t->pml4 == NULL)
-      goto done;
-   process_activate(thread_current());
+/* The parts of an executable that load() needs, parsed out of its ELF
+ * and program headers. */
+struct exec_image
+{
+   struct list_elem elem;      /* Element in exec_cache. */
+   struct inode *inode;        /* Executable, if cached. */
+   unsigned generation;        /* inode_generation() when parsed. */
+   uint64_t entry;             /* Entry point. */
+   size_t seg_cnt;             /* Number of loadable segments. */
+   struct exec_segment segs[]; /* Loadable segments. */
+};
 
-   /* Open executable file. */
-   lock_acquire(&filesys_lock);
-   file = filesys_open(file_name);
-   if (file == NULL)
+/* Maximum number of cached images. */
+#define EXEC_CACHE_SIZE 8
+
+/* Images of recently run executables, most recently used first, so that
+ * running the same program again skips reading and checking its headers.
+ * An entry keeps its inode open, so the inode, and with it the inode's
+ * generation, outlives the processes running it; writing to the file
+ * changes the generation and makes the entry stale.  Removing the file
+ * drops its entry at once, see exec_cache_forget(), so that the cache
+ * does not keep the removed file's inode and sectors alive.  Shared
+ * text pages are kept warm separately, see file_text_share().
+ * Protected by filesys_lock. */
+static struct list exec_cache;
+static long long exec_hit_cnt;  /* Loads that found a cached image. */
+static long long exec_miss_cnt; /* Loads that parsed the headers. */
+
+static void exec_cache_forget(struct inode *inode);
+
+/* Initializes the executable image cache. */
+void process_exec_cache_init(void)
+{
+   list_init(&exec_cache);
+   inode_set_remove_hook(exec_cache_forget);
+}
+
+/* Prints executable image cache statistics. */
+void process_print_stats(void)
+{
+   printf("Exec cache: %lld hits, %lld misses\n", exec_hit_cnt, exec_miss_cnt);
+}
+
+/* Returns a new image with room for SEG_CNT segments that holds the
+ * first SEG_CNT segments of SRC, or a null pointer if memory runs out. */
+static struct exec_image *
+exec_image_dup(const struct exec_image *src, size_t seg_cnt)
+{
+   struct exec_image *image = malloc(sizeof *image + seg_cnt * sizeof *image->segs);
+   if (image == NULL)
+      return NULL;
+   image->inode = NULL;
+   image->generation = src->generation;
+   image->entry = src->entry;
+   image->seg_cnt = seg_cnt;
+   memcpy(image->segs, src->segs, seg_cnt * sizeof *image->segs);
+   return image;
+}
+
+/* Removes IMAGE from the cache and frees it. */
+static void
+exec_cache_drop(struct exec_image *image)
+{
+   list_remove(&image->elem);
+   inode_close(image->inode);
+   free(image);
+}
+
+/* Drops the cached images of INODE, which is being removed.  A stale
+ * image may still sit behind the current one, so all of them go.  The
+ * remover holds its own reference to INODE, so closing ours here does
+ * not free it under inode_remove(). */
+static void
+exec_cache_forget(struct inode *inode)
+{
+   struct list_elem *e = list_begin(&exec_cache);
+
+   while (e != list_end(&exec_cache))
    {
-      lock_release(&filesys_lock);
-      printf("load: %s: open failed\n", file_name);
-      goto done;
+      struct exec_image *image = list_entry(e, struct exec_image, elem);
+
+      e = list_next(e);
+      if (image->inode == inode)
+         exec_cache_drop(image);
    }
+}
 
-   t->running_file = file;
-   file_deny_write(file);
-   lock_release(&filesys_lock);
+/* Returns the cached image of INODE, or a null pointer.  Drops the stale
+ * entries passed on the way. */
+static struct exec_image *
+exec_cache_find(struct inode *inode)
+{
+   struct list_elem *e = list_begin(&exec_cache);
+
+   while (e != list_end(&exec_cache))
+   {
+      struct exec_image *image = list_entry(e, struct exec_image, elem);
+
+      e = list_next(e);
+      if (image->generation != inode_generation(image->inode))
+         exec_cache_drop(image);
+      else if (image->inode == inode)
+      {
+         list_remove(&image->elem);
+         list_push_front(&exec_cache, &image->elem);
+         return image;
+      }
+   }
+   return NULL;
+}
+
+/* Reads and checks the ELF and program headers of FILE, the executable
+ * FILE_NAME.  Returns its image, or a null pointer on failure. */
+static struct exec_image *
+exec_image_parse(struct file *file, const char *file_name)
+{
+   struct exec_image *image;
+   struct ELF ehdr;
+   off_t file_ofs;
+   int i;
 
    /* Read and verify executable header. */
    if (file_read(file, &ehdr, sizeof ehdr) != sizeof ehdr || memcmp(ehdr.e_ident, "\177ELF\2\1\1", 7) || ehdr.e_type != 2 || ehdr.e_machine != 0x3E // amd64
        || ehdr.e_version != 1 || ehdr.e_phentsize != sizeof(struct Phdr) || ehdr.e_phnum > 1024)
    {
       printf("load: %s: error loading executable\n", file_name);
-      goto done;
+      return NULL;
    }
 
+   image = malloc(sizeof *image + ehdr.e_phnum * sizeof *image->segs);
+   if (image == NULL)
+      return NULL;
+   image->inode = NULL;
+   image->generation = inode_generation(file_get_inode(file));
+   image->entry = ehdr.e_entry;
+   image->seg_cnt = 0;
+
    /* Read program headers. */
    file_ofs = ehdr.e_phoff;
    for (i = 0; i < ehdr.e_phnum; i++)
@@ -534,11 +884,11 @@ load(const char *file_name, struct intr_frame *if_)
       struct Phdr phdr;
 
       if (file_ofs < 0 || file_ofs > file_length(file))
-         goto done;
+         goto fail;
       file_seek(file, file_ofs);
 
       if (file_read(file, &phdr, sizeof phdr) != sizeof phdr)
-         goto done;
+         goto fail;
       file_ofs += sizeof phdr;
       switch (phdr.p_type)
       {
@@ -552,45 +902,132 @@ load(const char *file_name, struct intr_frame *if_)
       case PT_DYNAMIC:
       case PT_INTERP:
       case PT_SHLIB:
-         goto done;
+         goto fail;
       case PT_LOAD:
          if (validate_segment(&phdr, file))
          {
-            bool writable = (phdr.p_flags & PF_W) != 0;
-            uint64_t file_page = phdr.p_offset & ~PGMASK;
-            uint64_t mem_page = phdr.p_vaddr & ~PGMASK;
+            struct exec_segment *seg = &image->segs[image->seg_cnt++];
             uint64_t page_offset = phdr.p_vaddr & PGMASK;
-            uint32_t read_bytes, zero_bytes;
+
+            seg->writable = (phdr.p_flags & PF_W) != 0;
+            seg->file_page = phdr.p_offset & ~PGMASK;
+            seg->mem_page = phdr.p_vaddr & ~PGMASK;
             if (phdr.p_filesz > 0)
             {
                /* Normal segment.
                 * Read initial part from disk and zero the rest. */
-               read_bytes = page_offset + phdr.p_filesz;
-               zero_bytes = (ROUND_UP(page_offset + phdr.p_memsz, PGSIZE) - read_bytes);
+               seg->read_bytes = page_offset + phdr.p_filesz;
+               seg->zero_bytes = (ROUND_UP(page_offset + phdr.p_memsz, PGSIZE) - seg->read_bytes);
             }
             else
             {
                /* Entirely zero.
                 * Don't read anything from disk. */
-               read_bytes = 0;
-               zero_bytes = ROUND_UP(page_offset + phdr.p_memsz, PGSIZE);
+               seg->read_bytes = 0;
+               seg->zero_bytes = ROUND_UP(page_offset + phdr.p_memsz, PGSIZE);
             }
-            if (!load_segment(file, file_page, (void *)mem_page,
-                              read_bytes, zero_bytes, writable))
-               goto done;
          }
          else
-            goto done;
+            goto fail;
          break;
       }
    }
+   return image;
+
+fail:
+   free(image);
+   return NULL;
+}
+
+/* Returns the image of FILE, the executable FILE_NAME, from the cache or
+ * by parsing its headers and caching the result.  The caller must free
+ * the image, and must hold filesys_lock and have denied writes to FILE,
+ * so that the image cannot go stale underneath it. */
+static struct exec_image *
+exec_image_get(struct file *file, const char *file_name)
+{
+   struct inode *inode = file_get_inode(file);
+   struct exec_image *image, *cached;
+
+   cached = exec_cache_find(inode);
+   if (cached != NULL)
+   {
+      exec_hit_cnt++;
+      return exec_image_dup(cached, cached->seg_cnt);
+   }
+
+   exec_miss_cnt++;
+   image = exec_image_parse(file, file_name);
+   if (image == NULL)
+      return NULL;
+
+   /* Cache a right-sized copy.  Without memory for it, the load still
+    * goes ahead uncached. */
+   cached = exec_image_dup(image, image->seg_cnt);
+   if (cached != NULL)
+   {
+      if (list_size(&exec_cache) >= EXEC_CACHE_SIZE)
+         exec_cache_drop(list_entry(list_back(&exec_cache), struct exec_image, elem));
+      cached->inode = inode_reopen(inode);
+      list_push_front(&exec_cache, &cached->elem);
+   }
+   return image;
+}
+
+/* Loads an ELF executable from FILE_NAME into the current thread.
+ * Stores the executable's entry point into *RIP
+ * and its initial stack pointer into *RSP.
+ * Returns true if successful, false otherwise. */
+static bool
+load(const char *file_name, struct intr_frame *if_)
+{
+   struct thread *t = thread_current();
+   struct exec_image *image = NULL;
+   struct file *file = NULL;
+   bool success = false;
+   size_t i;
+
+   /* Allocate and activate page directory. */
+   t->pml4 = pml4_create();
+   if (t->pml4 == NULL)
+      goto done;
+   process_activate(thread_current());
+
+   /* Open executable file. */
+   lock_acquire(&filesys_lock);
+   file = filesys_open(file_name);
+   if (file == NULL)
+   {
+      lock_release(&filesys_lock);
+      printf("load: %s: open failed\n", file_name);
+      goto done;
+   }
+
+   t->running_file = file;
+   file_deny_write(file);
+
+   /* Read and verify the executable and program headers, unless the
+    * executable has been run before and not changed since. */
+   image = exec_image_get(file, file_name);
+   lock_release(&filesys_lock);
+   if (image == NULL)
+      goto done;
+
+   for (i = 0; i < image->seg_cnt; i++)
+   {
+      const struct exec_segment *seg = &image->segs[i];
+
+      if (!load_segment(file, seg->file_page, (void *)seg->mem_page,
+                        seg->read_bytes, seg->zero_bytes, seg->writable))
+         goto done;
+   }
 
    /* Set up stack. */
    if (!setup_stack(if_))
       goto done;
 
    /* Start address. */
-   if_->rip = ehdr.e_entry;
+   if_->rip = image->entry;
 
    /* TODO: Your code goes here.
     * TODO: Implement argument passing (see project2/argument_passing.html). */
@@ -600,6 +1037,7 @@ load(const char *file_name, struct intr_frame *if_)
 done:
    /* We arrive here whether the load is successful or not. */
    // file_close (file);
+   free(image);
    return success;
 }
 
@@ -761,9 +1199,15 @@ install_page(void *upage, void *kpage, bool writable)
 static bool
 lazy_load_segment(struct page *page, void *aux)
 {
-   /* TODO: Load the segment from the file */
-   /* TODO: This called when the first page fault occurs on address VA. */
-   /* TODO: VA is available when calling this function. */
+   /* Load the segment from the file.  The page is already zeroed, so
+    * only the part backed by the file has to be read. */
+   struct file_load_info *info = aux;
+   bool locked = vm_filesys_lock();
+   off_t bytes_read = file_read_at(info->file, page->frame->kva,
+                                   info->read_bytes, info->ofs);
+   vm_filesys_unlock(locked);
+
+   return bytes_read == (off_t)info->read_bytes;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -796,16 +1240,32 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-      /* TODO: Set up aux to pass information to the lazy_load_segment. */
-      void *aux = NULL;
-      if (!vm_alloc_page_with_initializer(VM_ANON, upage,
-                                          writable, lazy_load_segment, aux))
+      /* Each lazy page keeps its own handle to the executable.
+       * Read-only segments are file-backed so that every process running
+       * the program maps the same frames (see file_text_share()). */
+      struct file_load_info src = {
+          .file = file,
+          .ofs = ofs,
+          .read_bytes = page_read_bytes,
+          .shared = !writable,
+      };
+      struct file_load_info *aux = file_load_info_dup(&src);
+      if (aux == NULL)
+         return false;
+      if (!vm_alloc_page_with_initializer(writable ? VM_ANON : VM_FILE, upage,
+                                          writable,
+                                          writable ? lazy_load_segment : file_load_page,
+                                          aux))
+      {
+         file_load_info_free(aux);
          return false;
+      }
 
       /* Advance. */
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
       upage += PGSIZE;
+      ofs += page_read_bytes;
    }
    return true;
 }
@@ -817,10 +1277,13 @@ setup_stack(struct intr_frame *if_)
    bool success = false;
    void *stack_bottom = (void *)(((uint8_t *)USER_STACK) - PGSIZE);
 
-   /* TODO: Map the stack on stack_bottom and claim the page immediately.
-    * TODO: If success, set the rsp accordingly.
-    * TODO: You should mark the page is stack. */
-   /* TODO: Your code goes here */
+   /* The first stack page is claimed right away, since the arguments are
+    * pushed onto it before the process runs.  VM_MARKER_0 marks stack
+    * pages. */
+   if (vm_alloc_page(VM_ANON | VM_MARKER_0, stack_bottom, true))
+      success = vm_claim_page(stack_bottom);
+   if (success)
+      if_->rsp = USER_STACK;
 
    return success;
 }
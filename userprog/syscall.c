@@ -1,9 +1,12 @@
 #include "userprog/syscall.h"
+#include <console.h>
+#include <limits.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
+#include "threads/malloc.h"
 #include "threads/loader.h"
 #include "userprog/gdt.h"
 #include "threads/init.h"
@@ -14,17 +17,24 @@
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "filesys/file.h"
+#include "filesys/pipe.h"
+#include "devices/disk.h"
+#include "devices/input.h"
 #include "userprog/process.h"
+#include "userprog/usercopy.h"
 #include <string.h>
+#ifdef VM
+#include "vm/vm.h"
+#endif
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
-void check_address(void *addr);
 void get_argument(void *rsp, int *arg, int count);
 void halt(void);
 void exit(int status);
-pid_t fork(const char *thread_name);
+static pid_t sys_fork(const char *thread_name, struct intr_frame *f);
 int exec(const char *cmd_line);
+pid_t spawn(const char *cmd_line, const int *fd_map, size_t fd_cnt);
 int wait(pid_t pid);
 bool create(const char *file, unsigned initial_size);
 bool remove(const char *file);
@@ -32,13 +42,34 @@ int open(const char *file);
 int filesize(int fd);
 int read(int fd, void *buffer, unsigned size);
 int write(int fd, const void *buffer, unsigned size);
+int readv(int fd, const struct iovec *iov, int iovcnt);
+int writev(int fd, const struct iovec *iov, int iovcnt);
+int pread(int fd, void *buffer, unsigned size, off_t offset);
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset);
+int ring_enter(struct io_ring *ring, unsigned to_submit);
+int copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+                    size_t len);
 void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
-void check_address(void *addr);
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
+void munmap(void *addr);
+int madvise(void *addr, size_t length, int advice);
+bool vmstat(struct vmstat *st);
+bool sysstat(int syscall_nr, bool system_wide, struct sysstat *st);
+int dmesg(char *buffer, unsigned size);
+int ttymode(int mode);
+int pipe(int fds[2]);
+int dup2(int oldfd, int newfd);
+static char *copy_in_string(const char *ustr);
+static struct iovec *copy_in_iovec(const struct iovec *iov, int iovcnt,
+                                   size_t *total);
 int process_add_file(struct file *f);
 struct file *process_get_file(int fd);
 
+/* Serializes every call into the file system. */
+struct lock filesys_lock;
+
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -66,60 +97,300 @@ void syscall_init(void)
    lock_init(&filesys_lock);
 }
 
+/* System call dispatch.
+ *
+ * syscall_table has one entry per number in syscall-nr.h.  Each entry
+ * unpacks the arguments from the frame for its function and says how
+ * that function reports failure, so that the handler can keep counts,
+ * errors and a latency histogram for every system call, both for the
+ * calling process and for the whole system.  Latency is measured with
+ * the TSC from entry to return, so it includes time spent blocked. */
+
+/* How a system call's return value reports failure. */
+enum syscall_ret
+{
+   RET_NONE, /* Cannot fail. */
+   RET_INT,  /* Negative int. */
+   RET_BOOL, /* False. */
+   RET_PTR,  /* Null pointer. */
+};
+
+struct syscall
+{
+   const char *name;
+   uint64_t (*func)(struct intr_frame *f);
+   enum syscall_ret ret;
+};
+
+static uint64_t sc_halt(struct intr_frame *f UNUSED)
+{
+   halt();
+   NOT_REACHED();
+}
+static uint64_t sc_exit(struct intr_frame *f)
+{
+   exit((int)f->R.rdi);
+   NOT_REACHED();
+}
+static uint64_t sc_fork(struct intr_frame *f)
+{
+   return sys_fork((const char *)f->R.rdi, f);
+}
+static uint64_t sc_exec(struct intr_frame *f)
+{
+   return exec((const char *)f->R.rdi);
+}
+static uint64_t sc_wait(struct intr_frame *f)
+{
+   return wait((pid_t)f->R.rdi);
+}
+static uint64_t sc_create(struct intr_frame *f)
+{
+   return create((const char *)f->R.rdi, (unsigned)f->R.rsi);
+}
+static uint64_t sc_remove(struct intr_frame *f)
+{
+   return remove((const char *)f->R.rdi);
+}
+static uint64_t sc_open(struct intr_frame *f)
+{
+   return open((const char *)f->R.rdi);
+}
+static uint64_t sc_filesize(struct intr_frame *f)
+{
+   return filesize((int)f->R.rdi);
+}
+static uint64_t sc_read(struct intr_frame *f)
+{
+   return read((int)f->R.rdi, (void *)f->R.rsi, (unsigned)f->R.rdx);
+}
+static uint64_t sc_write(struct intr_frame *f)
+{
+   return write((int)f->R.rdi, (const void *)f->R.rsi, (unsigned)f->R.rdx);
+}
+static uint64_t sc_seek(struct intr_frame *f)
+{
+   seek((int)f->R.rdi, (unsigned)f->R.rsi);
+   return 0;
+}
+static uint64_t sc_tell(struct intr_frame *f)
+{
+   return tell((int)f->R.rdi);
+}
+static uint64_t sc_close(struct intr_frame *f)
+{
+   close((int)f->R.rdi);
+   return 0;
+}
+static uint64_t sc_mmap(struct intr_frame *f)
+{
+   return (uint64_t)mmap((void *)f->R.rdi, (size_t)f->R.rsi, (int)f->R.rdx,
+                         (int)f->R.r10, (off_t)f->R.r8);
+}
+static uint64_t sc_munmap(struct intr_frame *f)
+{
+   munmap((void *)f->R.rdi);
+   return 0;
+}
+static uint64_t sc_madvise(struct intr_frame *f)
+{
+   return madvise((void *)f->R.rdi, (size_t)f->R.rsi, (int)f->R.rdx);
+}
+static uint64_t sc_vmstat(struct intr_frame *f)
+{
+   return vmstat((struct vmstat *)f->R.rdi);
+}
+static uint64_t sc_spawn(struct intr_frame *f)
+{
+   return spawn((const char *)f->R.rdi, (const int *)f->R.rsi,
+                (size_t)f->R.rdx);
+}
+static uint64_t sc_readv(struct intr_frame *f)
+{
+   return readv((int)f->R.rdi, (const struct iovec *)f->R.rsi, (int)f->R.rdx);
+}
+static uint64_t sc_writev(struct intr_frame *f)
+{
+   return writev((int)f->R.rdi, (const struct iovec *)f->R.rsi, (int)f->R.rdx);
+}
+static uint64_t sc_pread(struct intr_frame *f)
+{
+   return pread((int)f->R.rdi, (void *)f->R.rsi, (unsigned)f->R.rdx,
+                (off_t)f->R.r10);
+}
+static uint64_t sc_pwrite(struct intr_frame *f)
+{
+   return pwrite((int)f->R.rdi, (const void *)f->R.rsi, (unsigned)f->R.rdx,
+                 (off_t)f->R.r10);
+}
+static uint64_t sc_ring_enter(struct intr_frame *f)
+{
+   return ring_enter((struct io_ring *)f->R.rdi, (unsigned)f->R.rsi);
+}
+static uint64_t sc_copy_file_range(struct intr_frame *f)
+{
+   return copy_file_range((int)f->R.rdi, (off_t *)f->R.rsi, (int)f->R.rdx,
+                          (off_t *)f->R.r10, (size_t)f->R.r8);
+}
+static uint64_t sc_sysstat(struct intr_frame *f)
+{
+   return sysstat((int)f->R.rdi, (bool)f->R.rsi, (struct sysstat *)f->R.rdx);
+}
+static uint64_t sc_dmesg(struct intr_frame *f)
+{
+   return dmesg((char *)f->R.rdi, (unsigned)f->R.rsi);
+}
+static uint64_t sc_ttymode(struct intr_frame *f)
+{
+   return ttymode((int)f->R.rdi);
+}
+static uint64_t sc_dup2(struct intr_frame *f)
+{
+   return dup2((int)f->R.rdi, (int)f->R.rsi);
+}
+static uint64_t sc_pipe(struct intr_frame *f)
+{
+   return pipe((int *)f->R.rdi);
+}
+
+/* Numbers without a function are not implemented. */
+static const struct syscall syscall_table[] = {
+    [SYS_HALT] = {"halt", sc_halt, RET_NONE},
+    [SYS_EXIT] = {"exit", sc_exit, RET_NONE},
+    [SYS_FORK] = {"fork", sc_fork, RET_INT},
+    [SYS_EXEC] = {"exec", sc_exec, RET_INT},
+    [SYS_WAIT] = {"wait", sc_wait, RET_INT},
+    [SYS_CREATE] = {"create", sc_create, RET_BOOL},
+    [SYS_REMOVE] = {"remove", sc_remove, RET_BOOL},
+    [SYS_OPEN] = {"open", sc_open, RET_INT},
+    [SYS_FILESIZE] = {"filesize", sc_filesize, RET_INT},
+    [SYS_READ] = {"read", sc_read, RET_INT},
+    [SYS_WRITE] = {"write", sc_write, RET_INT},
+    [SYS_SEEK] = {"seek", sc_seek, RET_NONE},
+    [SYS_TELL] = {"tell", sc_tell, RET_NONE},
+    [SYS_CLOSE] = {"close", sc_close, RET_NONE},
+    [SYS_MMAP] = {"mmap", sc_mmap, RET_PTR},
+    [SYS_MUNMAP] = {"munmap", sc_munmap, RET_NONE},
+    [SYS_DUP2] = {"dup2", sc_dup2, RET_INT},
+    [SYS_MADVISE] = {"madvise", sc_madvise, RET_INT},
+    [SYS_VMSTAT] = {"vmstat", sc_vmstat, RET_BOOL},
+    [SYS_SPAWN] = {"spawn", sc_spawn, RET_INT},
+    [SYS_READV] = {"readv", sc_readv, RET_INT},
+    [SYS_WRITEV] = {"writev", sc_writev, RET_INT},
+    [SYS_PREAD] = {"pread", sc_pread, RET_INT},
+    [SYS_PWRITE] = {"pwrite", sc_pwrite, RET_INT},
+    [SYS_RING_ENTER] = {"ring_enter", sc_ring_enter, RET_INT},
+    [SYS_COPY_FILE_RANGE] = {"copy_file_range", sc_copy_file_range, RET_INT},
+    [SYS_SYSSTAT] = {"sysstat", sc_sysstat, RET_BOOL},
+    [SYS_DMESG] = {"dmesg", sc_dmesg, RET_INT},
+    [SYS_TTYMODE] = {"ttymode", sc_ttymode, RET_INT},
+    [SYS_PIPE] = {"pipe", sc_pipe, RET_INT},
+};
+
+#define SYSCALL_CNT ((int)(sizeof syscall_table / sizeof *syscall_table))
+
+/* System-wide statistics, indexed by system call number.  Updated with
+ * interrupts off, since every process adds to them. */
+static struct sysstat syscall_stats[SYSCALL_CNT];
+
+/* Print system call and exec cache statistics at power off?
+ * Controlled by kernel command-line option "-scstats". */
+bool syscall_exit_stats;
+
+/* Adds a call to ST.  If CYCLES is nonzero the call has returned, taking
+ * that many cycles, and FAILED says whether it failed. */
+static void stat_add(struct sysstat *st, uint64_t cycles, bool failed)
+{
+   int bucket;
+
+   if (cycles == 0)
+   {
+      st->calls++;
+      return;
+   }
+   bucket = 63 - __builtin_clzll(cycles | 1) - SYSSTAT_SHIFT + 1;
+   if (bucket < 0)
+      bucket = 0;
+   if (bucket >= SYSSTAT_BUCKETS)
+      bucket = SYSSTAT_BUCKETS - 1;
+   st->errors += failed;
+   st->cycles += cycles;
+   st->hist[bucket]++;
+}
+
+/* Adds a call to system call NR to the system-wide statistics and to
+ * those of the current process, allocating the latter on its first
+ * system call.  See stat_add() for CYCLES and FAILED. */
+static void syscall_account(int nr, uint64_t cycles, bool failed)
+{
+   struct thread *cur = thread_current();
+   enum intr_level old_level;
+
+   if (cur->syscall_stats == NULL)
+      cur->syscall_stats = calloc(SYSCALL_CNT, sizeof *cur->syscall_stats);
+   if (cur->syscall_stats != NULL)
+      stat_add(&cur->syscall_stats[nr], cycles, failed);
+
+   old_level = intr_disable();
+   stat_add(&syscall_stats[nr], cycles, failed);
+   intr_set_level(old_level);
+}
+
 /* The main system call interface */
 void syscall_handler(struct intr_frame *f UNUSED)
 {
-   // TODO: Your implementation goes here.
-   check_address(f->rsp);
-   struct thread *cur = thread_current();
-   memcpy(&cur->tf, f, sizeof(struct intr_frame));
-   int syscall_num = f->R.rax;
-   switch (syscall_num)
+#ifdef VM
+   thread_current()->user_rsp = (void *)f->rsp;
+#endif
+   uint64_t nr = f->R.rax;
+   const struct syscall *sc;
+   uint64_t start, ret;
+   bool failed;
+
+   if (nr >= SYSCALL_CNT || syscall_table[nr].func == NULL)
+      thread_exit();
+   sc = &syscall_table[nr];
+
+   /* 반환하지 않는 시스템 콜(exit, exec 성공 등)도 호출 횟수는 남도록 먼저 기록 */
+   syscall_account(nr, 0, false);
+   start = rdtsc();
+   f->R.rax = ret = sc->func(f);
+
+   switch (sc->ret)
    {
-   case SYS_HALT: /* Halt the operating system. */
-      halt();
-      break;
-   case SYS_EXIT: /* Terminate this process. */
-      exit(f->R.rdi);
-      break;
-   case SYS_FORK: /* Clone current process. */
-      f->R.rax = fork(f->R.rdi);
-      break;
-   case SYS_EXEC: /* Switch current process. */
-      f->R.rax = exec(f->R.rdi);
-      break;
-   case SYS_WAIT: /* Wait for a child process to die. */
-      f->R.rax = wait(f->R.rdi);
-      break;
-   case SYS_CREATE: /* Create a file. */
-      f->R.rax = create(f->R.rdi, f->R.rsi);
-      break;
-   case SYS_REMOVE: /* Delete a file. */
-      f->R.rax = remove(f->R.rdi);
+   case RET_INT:
+      failed = (int)ret < 0;
       break;
-   case SYS_OPEN: /* Open a file. */
-      f->R.rax = open(f->R.rdi);
-      break;
-   case SYS_FILESIZE: /* Obtain a file's size. */
-      f->R.rax = filesize(f->R.rdi);
-      break;
-   case SYS_READ: /* Read from a file. */
-      f->R.rax = read(f->R.rdi, f->R.rsi, f->R.rdx);
-      break;
-   case SYS_WRITE: /* Write to a file. */
-      f->R.rax = write(f->R.rdi, f->R.rsi, f->R.rdx);
-      break;
-   case SYS_SEEK: /* Change position in a file. */
-      seek(f->R.rdi, f->R.rsi);
-      break;
-   case SYS_TELL: /* Report current position in a file. */
-      f->R.rax = tell(f->R.rdi);
-      break;
-   case SYS_CLOSE: /* Close a file. */
-      close(f->R.rdi);
+   case RET_BOOL:
+   case RET_PTR:
+      failed = ret == 0;
       break;
    default:
-      thread_exit();
+      failed = false;
+   }
+   syscall_account(nr, rdtsc() - start, failed);
+}
+
+/* Prints the system-wide statistics of every system call that has been
+ * called, one line each with its latency histogram. */
+void syscall_print_stats(void)
+{
+   for (int nr = 0; nr < SYSCALL_CNT; nr++)
+   {
+      struct sysstat *st = &syscall_stats[nr];
+      long long returned = 0;
+
+      if (st->calls == 0)
+         continue;
+      for (int i = 0; i < SYSSTAT_BUCKETS; i++)
+         returned += st->hist[i];
+      printf("Syscall %s: %lld calls, %lld errors, %lld cycles avg;",
+             syscall_table[nr].name, st->calls, st->errors,
+             returned > 0 ? st->cycles / returned : 0);
+      for (int i = 0; i < SYSSTAT_BUCKETS; i++)
+         if (st->hist[i] != 0)
+            printf(" <2^%d:%u", SYSSTAT_SHIFT + i, st->hist[i]);
+      printf("\n");
    }
 }
 
@@ -148,8 +419,14 @@ void exit(int status)
 */
 bool create(const char *file, unsigned initial_size)
 {
-   check_address(file);
-   return filesys_create(file, initial_size);
+   char *name = copy_in_string(file);
+   bool success;
+
+   if (name == NULL)
+      return false;
+   success = filesys_create(name, initial_size);
+   palloc_free_page(name);
+   return success;
 }
 
 /*
@@ -160,8 +437,17 @@ bool create(const char *file, unsigned initial_size)
 */
 bool remove(const char *file)
 {
-   check_address(file);
-   return filesys_remove(file);
+   char *name = copy_in_string(file);
+   bool success;
+
+   if (name == NULL)
+      return false;
+   /* 실행 파일 캐시가 filesys_lock 아래에서 이 파일의 항목을 정리합니다. */
+   lock_acquire(&filesys_lock);
+   success = filesys_remove(name);
+   lock_release(&filesys_lock);
+   palloc_free_page(name);
+   return success;
 }
 
 /*
@@ -169,10 +455,14 @@ THREAD_NAME이라는 이름을 가진 현재 프로세스의 복제본인 새 
 피호출자(callee) 저장 레지스터인 %RBX, %RSP, %RBP와 %R12 - %R15를 제외한 레지스터 값을 복제할 필요가 없습니다.
  자식 프로세스의 pid를 반환해야 합니다.
 */
-pid_t fork(const char *thread_name)
+static pid_t sys_fork(const char *thread_name, struct intr_frame *f)
 {
-   struct thread *cur = thread_current();
-   return process_fork(thread_name, &cur->tf);
+   char name[16];
+
+   if (strncpy_from_user(name, thread_name, sizeof name) < 0)
+      exit(-1);
+   name[sizeof name - 1] = '\0';
+   return process_fork(name, f);
 }
 /*
 현재의 프로세스가 cmd_line에서 이름이 주어지는 실행가능한 프로세스로 변경됩니다. 이때 주어진 인자들을 전달합니다.
@@ -183,10 +473,9 @@ int exec(const char *cmd_line)
    char *fn_copy;
    tid_t tid;
 
-   fn_copy = palloc_get_page(PAL_ZERO);
+   fn_copy = copy_in_string(cmd_line);
    if (fn_copy == NULL)
       return TID_ERROR;
-   strlcpy(fn_copy, cmd_line, PGSIZE);
    tid = process_exec(fn_copy);
    if (tid == -1)
    {
@@ -211,8 +500,13 @@ file(첫 번째 인자)이라는 이름을 가진 파일을 엽니다. 해당 
 */
 int open(const char *file)
 {
-   check_address(file);
-   struct file *open_file = filesys_open(file);
+   char *name = copy_in_string(file);
+   struct file *open_file;
+
+   if (name == NULL)
+      return -1;
+   open_file = filesys_open(name);
+   palloc_free_page(name);
    if (open_file == NULL)
    {
       return -1;
@@ -225,56 +519,249 @@ int open(const char *file)
    return fd;
 }
 /*
+fork 후 exec 하는 대신, 부모의 주소 공간을 복사하지 않고 cmd_line을 실행하는 자식 프로세스를 만듭니다.
+fd_map이 NULL이면 fork처럼 열린 파일을 모두 상속하고, 아니면 자식의 fd i(FD_MIN <= i < fd_cnt)가
+부모의 fd fd_map[i]를 가리킵니다(-1이면 닫힌 채로 둠). fd 0, 1은 항상 부모의 것을 상속하므로
+dup2로 바꾼 것도 따라갑니다. 자식이 load에 실패하면 -1을 반환합니다.
+*/
+pid_t spawn(const char *cmd_line, const int *fd_map, size_t fd_cnt)
+{
+   char *cmd;
+   int *map = NULL;
+   pid_t pid = -1;
+
+   cmd = copy_in_string(cmd_line);
+   if (cmd == NULL)
+      return -1;
+   if (fd_map != NULL)
+   {
+      if (fd_cnt > FD_MAX)
+         goto done;
+      map = palloc_get_page(0);
+      if (map == NULL)
+         goto done;
+      if (!copy_from_user(map, fd_map, fd_cnt * sizeof *map))
+      {
+         palloc_free_page(map);
+         palloc_free_page(cmd);
+         exit(-1);
+      }
+      for (size_t i = FD_MIN; i < fd_cnt; i++)
+         if (map[i] != -1 && process_get_file(map[i]) == NULL)
+            goto done;
+   }
+   pid = process_spawn(cmd, map, fd_cnt);
+done:
+   if (map != NULL)
+      palloc_free_page(map);
+   palloc_free_page(cmd);
+   return pid;
+}
+/*
 fd(첫 번째 인자)로서 열려 있는 파일의 크기가 몇 바이트인지 반환합니다.
 */
 int filesize(int fd)
 {
 
    struct file *find_file = process_get_file(fd);
-   if (find_file == NULL)
+   if (find_file == NULL || file_get_pipe(find_file, NULL) != NULL)
       return -1;
    return file_length(find_file);
 }
+/* 유저 버퍼 목록(iovec 배열) 위의 현재 위치 */
+struct iov_iter
+{
+   const struct iovec *iov; /* 남은 버퍼들 (커널에 복사해 둔 배열) */
+   int cnt;                 /* 남은 버퍼 수 */
+   size_t ofs;              /* iov[0] 안에서의 위치 */
+   size_t left;             /* 남은 바이트 수 */
+};
+
+/*
+커널 버퍼 kbuf와 it가 가리키는 유저 버퍼들 사이에서 size 바이트를 복사하고 it를 그만큼 진행합니다.
+to_user이면 유저 버퍼로 씁니다. 유저 버퍼가 올바르지 않으면 false를 반환합니다.
+*/
+static bool iov_iter_copy(struct iov_iter *it, uint8_t *kbuf, size_t size, bool to_user)
+{
+   while (size > 0)
+   {
+      uint8_t *ubuf = (uint8_t *)it->iov->iov_base + it->ofs;
+      size_t n = it->iov->iov_len - it->ofs;
+
+      if (n > size)
+         n = size;
+      if (to_user ? !copy_to_user(ubuf, kbuf, n) : !copy_from_user(kbuf, ubuf, n))
+         return false;
+      kbuf += n;
+      size -= n;
+      it->ofs += n;
+      it->left -= n;
+      while (it->cnt > 0 && it->ofs == it->iov->iov_len)
+      {
+         it->iov++;
+         it->cnt--;
+         it->ofs = 0;
+      }
+   }
+   return true;
+}
+
 /*
-buffer 안에 fd 로 열려있는 파일로부터 size 바이트를 읽습니다.
-실제로 읽어낸 바이트의 수 를 반환합니다 (파일 끝에서 시도하면 0).
-파일이 읽어질 수 없었다면 -1을 반환합니다.
+fd에서 it가 가리키는 유저 버퍼들로 읽습니다. 읽은 바이트 수를 반환합니다.
+pos가 NULL이 아니면 파일의 현재 위치 대신 *pos부터 읽고 *pos를 진행합니다(콘솔은 -1).
+한 페이지씩 커널 페이지에 읽은 뒤 copy_to_user로 옮기므로, 파일 시스템 락을 잡은 채로
+유저 메모리에서 page fault가 나지 않고 잘못된 버퍼는 복사할 때 걸러집니다.
+전체가 한 페이지 이하이면 락도 파일 읽기도 한 번뿐입니다.
+콘솔(fd 0)은 TTY 계층에서 한 번만 읽으므로, canonical 모드에서는 많아야 한 줄을 반환합니다.
+파이프도 한 번만 읽으므로 있는 만큼만 반환하고, 쓰는 쪽이 모두 닫혀 비어 있으면 0입니다.
 */
-int read(int fd, void *buffer, unsigned size)
+static int do_read(int fd, struct iov_iter *it, off_t *pos)
 {
-   check_address(buffer);
-   int file_size;
-   char *read_buffer = buffer;
-   if (fd == 0)
+   struct file *read_file = process_get_file(fd);
+   struct pipe *pipe = NULL;
+   bool writer = false;
+   uint8_t *bounce;
+   int file_size = 0;
+
+   /* fd 0은 dup2로 다른 파일이 들어가 있지 않으면 콘솔 */
+   if (read_file == NULL && fd != STDIN_FILENO)
+      return -1;
+   if (read_file != NULL)
+      pipe = file_get_pipe(read_file, &writer);
+   if (writer || (pos != NULL && (read_file == NULL || pipe != NULL)))
+      return -1;
+   if (it->left == 0)
+      return 0;
+
+   bounce = palloc_get_page(0);
+   if (bounce == NULL)
+      return -1;
+   while (it->left > 0)
    {
-      char key;
-      for (file_size = 0; file_size < size; file_size++)
+      unsigned chunk = it->left < PGSIZE ? it->left : PGSIZE;
+      unsigned n, copy;
+
+      if (read_file == NULL)
+      {
+         n = input_read(bounce, chunk);
+         copy = n;
+      }
+      else if (pipe != NULL)
       {
-         key = input_getc();
-         *read_buffer++ = key;
-         if (key == '\0')
+         n = pipe_read(pipe, bounce, chunk);
+         copy = n;
+      }
+      else
+      {
+         lock_acquire(&filesys_lock);
+         if (pos != NULL)
          {
-            break;
+            n = file_read_at(read_file, bounce, chunk, *pos);
+            *pos += n;
          }
+         else
+            n = file_read(read_file, bounce, chunk);
+         lock_release(&filesys_lock);
+         copy = n;
       }
+      if (!iov_iter_copy(it, bounce, copy, true))
+      {
+         palloc_free_page(bounce);
+         exit(-1);
+      }
+      file_size += n;
+      /* 콘솔과 파이프는 있는 만큼만 읽고 돌아감 */
+      if (n < chunk || read_file == NULL || pipe != NULL)
+         break;
    }
-   else if (fd == 1)
-   {
+   palloc_free_page(bounce);
+   return file_size;
+}
+
+/*
+it가 가리키는 유저 버퍼들을 모아 fd에 씁니다. 쓴 바이트 수를 반환하고,
+한 번이라도 덜 써지면 거기서 멈춥니다. pos는 do_read와 같습니다. 버퍼들은 한 페이지씩 커널 페이지로 모아서 쓰므로,
+전체가 한 페이지 이하이면 락도 파일 쓰기도 한 번뿐입니다.
+*/
+static int do_write(int fd, struct iov_iter *it, off_t *pos)
+{
+   struct file *write_file = process_get_file(fd);
+   struct pipe *pipe = NULL;
+   bool writer = true;
+   uint8_t *bounce;
+   int file_size = 0;
+
+   /* fd 1은 dup2로 다른 파일이 들어가 있지 않으면 콘솔 */
+   if (write_file == NULL && fd != STDOUT_FILENO)
       return -1;
-   }
-   else
+   if (write_file != NULL)
+      pipe = file_get_pipe(write_file, &writer);
+   if (!writer || (pos != NULL && (write_file == NULL || pipe != NULL)))
+      return -1;
+   if (it->left == 0)
+      return 0;
+
+   bounce = palloc_get_page(0);
+   if (bounce == NULL)
+      return -1;
+   while (it->left > 0)
    {
-      struct file *read_file = process_get_file(fd);
-      if (read_file == NULL)
+      unsigned chunk = it->left < PGSIZE ? it->left : PGSIZE;
+      unsigned n;
+
+      if (!iov_iter_copy(it, bounce, chunk, false))
       {
-         return -1;
+         palloc_free_page(bounce);
+         exit(-1);
       }
-      lock_acquire(&filesys_lock);
-      file_size = file_read(read_file, buffer, size);
-      lock_release(&filesys_lock);
+      if (write_file == NULL)
+      {
+         putbuf((const char *)bounce, chunk);
+         n = chunk;
+      }
+      else if (pipe != NULL)
+      {
+         /* 읽는 쪽이 모두 닫혔으면 -1, 쓰는 도중 닫혔으면 거기까지 */
+         int written = pipe_write(pipe, bounce, chunk);
+         if (written < 0)
+         {
+            palloc_free_page(bounce);
+            return file_size > 0 ? file_size : -1;
+         }
+         n = written;
+      }
+      else
+      {
+         lock_acquire(&filesys_lock);
+         if (pos != NULL)
+         {
+            n = file_write_at(write_file, bounce, chunk, *pos);
+            *pos += n;
+         }
+         else
+            n = file_write(write_file, bounce, chunk);
+         lock_release(&filesys_lock);
+      }
+      file_size += n;
+      if (n < chunk)
+         break;
    }
+   palloc_free_page(bounce);
    return file_size;
 }
+
+/*
+buffer 안에 fd 로 열려있는 파일로부터 size 바이트를 읽습니다.
+실제로 읽어낸 바이트의 수 를 반환합니다 (파일 끝에서 시도하면 0).
+파일이 읽어질 수 없었다면 -1을 반환합니다.
+*/
+int read(int fd, void *buffer, unsigned size)
+{
+   struct iovec iov = {.iov_base = buffer, .iov_len = size};
+   struct iov_iter it = {.iov = &iov, .cnt = 1, .ofs = 0, .left = size};
+
+   return do_read(fd, &it, NULL);
+}
 /*
 buffer로부터 open file fd로 size 바이트를 적어줍니다.
 실제로 적힌 바이트의 수를 반환해주고,
@@ -282,25 +769,153 @@ buffer로부터 open file fd로 size 바이트를 적어줍니다.
 */
 int write(int fd, const void *buffer, unsigned size)
 {
-   int file_size;
-   if (fd == STDOUT_FILENO)
-   {
-      putbuf(buffer, size);
-      file_size = size;
-   }
-   else if (fd == STDIN_FILENO)
-   {
+   struct iovec iov = {.iov_base = (void *)buffer, .iov_len = size};
+   struct iov_iter it = {.iov = &iov, .cnt = 1, .ofs = 0, .left = size};
+
+   return do_write(fd, &it, NULL);
+}
+/*
+fd에서 읽어 iov[0]부터 iov[iovcnt - 1]까지의 버퍼를 차례로 채웁니다.
+읽은 바이트 수의 합을 반환하며, 파일 끝에 닿으면 그보다 적을 수 있습니다.
+iovcnt가 0에서 IOV_MAX 사이가 아니거나 길이의 합이 int를 넘으면 -1을 반환합니다.
+*/
+int readv(int fd, const struct iovec *iov, int iovcnt)
+{
+   struct iov_iter it;
+   struct iovec *kiov;
+   size_t total;
+   int result;
+
+   kiov = copy_in_iovec(iov, iovcnt, &total);
+   if (kiov == NULL)
       return -1;
-   }
-   else
+   it = (struct iov_iter){.iov = kiov, .cnt = iovcnt, .ofs = 0, .left = total};
+   result = do_read(fd, &it, NULL);
+   palloc_free_page(kiov);
+   return result;
+}
+/*
+iov[0]부터 iov[iovcnt - 1]까지의 버퍼를 차례로 이어 붙여 fd에 씁니다.
+쓴 바이트 수의 합을 반환하며, 일부만 써졌다면 그보다 적을 수 있습니다.
+인자 제한은 readv와 같습니다.
+*/
+int writev(int fd, const struct iovec *iov, int iovcnt)
+{
+   struct iov_iter it;
+   struct iovec *kiov;
+   size_t total;
+   int result;
+
+   kiov = copy_in_iovec(iov, iovcnt, &total);
+   if (kiov == NULL)
+      return -1;
+   it = (struct iov_iter){.iov = kiov, .cnt = iovcnt, .ofs = 0, .left = total};
+   result = do_write(fd, &it, NULL);
+   palloc_free_page(kiov);
+   return result;
+}
+/*
+read와 같지만 파일의 현재 위치 대신 offset부터 읽고, 현재 위치는 바꾸지 않습니다.
+그래서 같은 파일을 공유하는 여러 스레드가 seek 없이 각자 다른 위치를 읽을 수 있습니다.
+offset이 음수이거나 fd가 콘솔이면 -1을 반환합니다.
+*/
+int pread(int fd, void *buffer, unsigned size, off_t offset)
+{
+   struct iovec iov = {.iov_base = buffer, .iov_len = size};
+   struct iov_iter it = {.iov = &iov, .cnt = 1, .ofs = 0, .left = size};
+
+   if (offset < 0)
+      return -1;
+   return do_read(fd, &it, &offset);
+}
+/*
+write와 같지만 파일의 현재 위치 대신 offset부터 쓰고, 현재 위치는 바꾸지 않습니다.
+offset이 음수이거나 fd가 콘솔이면 -1을 반환합니다.
+*/
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset)
+{
+   struct iovec iov = {.iov_base = (void *)buffer, .iov_len = size};
+   struct iov_iter it = {.iov = &iov, .cnt = 1, .ofs = 0, .left = size};
+
+   if (offset < 0)
+      return -1;
+   return do_write(fd, &it, &offset);
+}
+/*
+fd_in 파일의 내용 len 바이트를 fd_out 파일로 커널 안에서 바로 복사합니다.
+off_in이 NULL이면 fd_in의 현재 위치부터 읽고 현재 위치를 진행하며, 아니면 *off_in부터 읽고
+*off_in을 진행합니다(off_out도 마찬가지). 복사한 바이트 수를 반환하며, 파일 끝에 닿거나
+덜 써지면 그보다 적을 수 있습니다. fd가 열린 파일이 아니거나, 위치가 음수이거나,
+같은 파일 안에서 두 범위가 겹치면 -1을 반환합니다.
+데이터는 커널 페이지 하나를 거쳐 file_read_at()과 file_write_at()으로 옮기며, 디스크 섹터끼리
+직접 옮기지는 않습니다. 사용자 공간을 거치지 않고 시스템 콜 한 번으로 끝난다는 점만 다릅니다.
+*/
+int copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+                    size_t len)
+{
+   struct file *in = process_get_file(fd_in);
+   struct file *out = process_get_file(fd_out);
+   off_t in_pos, out_pos;
+   uint8_t *bounce;
+   int copied = 0;
+
+   if (in == NULL || out == NULL || file_get_pipe(in, NULL) != NULL
+       || file_get_pipe(out, NULL) != NULL)
+      return -1;
+   if (off_in == NULL)
+      in_pos = file_tell(in);
+   else if (!copy_from_user(&in_pos, off_in, sizeof in_pos))
+      exit(-1);
+   if (off_out == NULL)
+      out_pos = file_tell(out);
+   else if (!copy_from_user(&out_pos, off_out, sizeof out_pos))
+      exit(-1);
+   if (in_pos < 0 || out_pos < 0)
+      return -1;
+   if (len > (size_t)INT_MAX)
+      len = INT_MAX;
+   if (file_get_inode(in) == file_get_inode(out)
+       && in_pos < (int64_t)out_pos + (int64_t)len
+       && out_pos < (int64_t)in_pos + (int64_t)len)
+      return -1;
+
+   bounce = palloc_get_page(0);
+   if (bounce == NULL)
+      return -1;
+   while ((size_t)copied < len)
    {
+      /* 쓰는 쪽을 섹터 경계에 맞춰 나누면 첫 조각 이후로는 섹터 전체를 쓰게 되어,
+         섹터 일부를 쓰기 위해 먼저 읽어 오는 일이 없음 */
+      size_t chunk = PGSIZE - out_pos % DISK_SECTOR_SIZE;
+      off_t n;
+
+      if (chunk > len - copied)
+         chunk = len - copied;
       lock_acquire(&filesys_lock);
-      file_size = file_write(process_get_file(fd), buffer, size);
+      n = file_read_at(in, bounce, chunk, in_pos);
+      if (n > 0)
+         n = file_write_at(out, bounce, n, out_pos);
       lock_release(&filesys_lock);
+      if (n <= 0)
+         break;
+      in_pos += n;
+      out_pos += n;
+      copied += n;
+      if ((size_t)n < chunk)
+         break;
    }
-   return file_size;
-}
+   palloc_free_page(bounce);
 
+   if (off_in == NULL)
+      file_seek(in, in_pos);
+   else if (!copy_to_user(off_in, &in_pos, sizeof in_pos))
+      exit(-1);
+   if (off_out == NULL)
+      file_seek(out, out_pos);
+   else if (!copy_to_user(off_out, &out_pos, sizeof out_pos))
+      exit(-1);
+   return copied;
+}
 /*
 open file fd에서 읽거나 쓸 다음 바이트를 position으로 변경합니다.
 position은 파일 시작부터 바이트 단위로 표시됩니다.
@@ -344,14 +959,317 @@ void close(int fd)
    return file_close(close_file);
 }
 /*
-주소 값이 유저 영역 주소 값인지 확인
-유저 영역을 벗어난 영역일 경우 프로세스 종료(exit(-1)
+fd로 열린 파일의 offset 바이트부터 length 바이트를 addr에 매핑합니다.
+콘솔 입출력 fd는 매핑할 수 없고, 실패하면 NULL을 반환합니다.
+*/
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
+{
+#ifdef VM
+   struct file *file = process_get_file(fd);
+   if (file == NULL || file_get_pipe(file, NULL) != NULL)
+      return NULL;
+   return do_mmap(addr, length, writable, file, offset);
+#else
+   (void)addr;
+   (void)length;
+   (void)writable;
+   (void)fd;
+   (void)offset;
+   return NULL;
+#endif
+}
+/*
+addr에서 시작하는 매핑을 해제합니다. 수정된 페이지는 파일에 다시 씁니다.
+*/
+void munmap(void *addr)
+{
+#ifdef VM
+   do_munmap(addr);
+#else
+   (void)addr;
+#endif
+}
+/*
+addr부터 length 바이트 영역을 앞으로 어떻게 사용할지 advice로 알려줍니다.
+접근 패턴(MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL)은 미리 읽어 둘 양을 정하고,
+MADV_WILLNEED는 지금 바로 로드하며, MADV_DONTNEED는 지금 바로 내보냅니다.
+addr이 페이지 정렬되지 않았거나 매핑되지 않은 페이지가 있으면 -1을 반환합니다.
+VM이 없으면 아무 일도 하지 않으므로 mmap()처럼 실패(-1)를 반환합니다.
+*/
+int madvise(void *addr UNUSED, size_t length UNUSED, int advice UNUSED)
+{
+#ifdef VM
+   return vm_madvise(addr, length, advice) ? 0 : -1;
+#else
+   return -1;
+#endif
+}
+/*
+현재 프로세스의 페이지 폴트 횟수, 스왑 인 횟수, RSS를 st에 채웁니다.
+VM이 없으면 통계가 없으므로 false를 반환합니다.
+*/
+bool vmstat(struct vmstat *st UNUSED)
+{
+#ifdef VM
+   struct vm_stats *stats = &thread_current()->vm_stats;
+   struct vmstat copy = {
+       .minor_faults = stats->minor_faults,
+       .major_faults = stats->major_faults,
+       .cow_faults = stats->cow_faults,
+       .stack_faults = stats->stack_faults,
+       .swap_ins = stats->swap_ins,
+       .rss = stats->rss,
+       .peak_rss = stats->peak_rss,
+   };
+   if (!copy_to_user(st, &copy, sizeof copy))
+      exit(-1);
+   return true;
+#else
+   return false;
+#endif
+}
+/*
+syscall_nr번 시스템 콜의 통계를 st에 채웁니다. system_wide가 true이면 시스템 전체,
+아니면 현재 프로세스의 통계입니다. 없는 번호이면 false를 반환합니다.
+*/
+bool sysstat(int syscall_nr, bool system_wide, struct sysstat *st)
+{
+   struct thread *cur = thread_current();
+   struct sysstat copy;
+
+   if (syscall_nr < 0 || syscall_nr >= SYSCALL_CNT)
+      return false;
+   if (system_wide)
+   {
+      enum intr_level old_level = intr_disable();
+      copy = syscall_stats[syscall_nr];
+      intr_set_level(old_level);
+   }
+   else if (cur->syscall_stats != NULL)
+      copy = cur->syscall_stats[syscall_nr];
+   else
+      memset(&copy, 0, sizeof copy);
+   if (!copy_to_user(st, &copy, sizeof copy))
+      exit(-1);
+   return true;
+}
+/*
+커널 로그(콘솔에 출력된 내용)의 마지막 size 바이트를 buffer에 복사하고 복사한
+바이트 수를 반환합니다. 로그에 남아 있는 내용이 그보다 적으면 남은 것만 복사합니다.
+*/
+int dmesg(char *buffer, unsigned size)
+{
+   uint64_t end = console_log_size();
+   uint64_t pos = end > size ? end - size : 0;
+   char *bounce;
+   int copied = 0;
+
+   if (size > INT_MAX)
+      return -1;
+   bounce = palloc_get_page(0);
+   if (bounce == NULL)
+      return -1;
+   while (pos < end)
+   {
+      size_t n = console_log_read(&pos, bounce,
+                                  end - pos < PGSIZE ? end - pos : PGSIZE);
+      if (n == 0)
+         break;
+      if (!copy_to_user(buffer + copied, bounce, n))
+      {
+         palloc_free_page(bounce);
+         exit(-1);
+      }
+      copied += n;
+   }
+   palloc_free_page(bounce);
+   return copied;
+}
+/*
+콘솔 입력 모드를 mode(TTY_RAW 또는 TTY_CANON, 여기에 TTY_ECHO를 OR할 수 있음)로
+바꾸고 이전 모드를 반환합니다. 알 수 없는 비트가 있으면 -1을 반환합니다.
+*/
+int ttymode(int mode)
+{
+   int old;
+
+   if (mode & ~(TTY_CANON | TTY_ECHO))
+      return -1;
+   old = input_set_mode((mode & TTY_CANON ? INPUT_CANON : INPUT_RAW)
+                        | (mode & TTY_ECHO ? INPUT_ECHO : 0));
+   return (old & INPUT_CANON ? TTY_CANON : TTY_RAW)
+          | (old & INPUT_ECHO ? TTY_ECHO : 0);
+}
+/*
+파이프를 만들고 읽는 쪽 fd를 fds[0]에, 쓰는 쪽 fd를 fds[1]에 씁니다.
+성공하면 0, 메모리나 fd가 모자라면 -1을 반환합니다.
+*/
+int pipe(int fds[2])
+{
+   struct pipe *p;
+   struct file *ends[2];
+   int kfds[2] = {-1, -1};
+
+   p = pipe_create();
+   if (p == NULL)
+      return -1;
+   ends[0] = file_open_pipe(p, false);
+   ends[1] = file_open_pipe(p, true);
+   if (ends[0] == NULL || ends[1] == NULL)
+   {
+      /* 만들지 못한 쪽은 직접 닫아 파이프가 해제되게 함 */
+      if (ends[0] == NULL)
+         pipe_unref(p, false);
+      if (ends[1] == NULL)
+         pipe_unref(p, true);
+      file_close(ends[0]);
+      file_close(ends[1]);
+      return -1;
+   }
+   for (int i = 0; i < 2; i++)
+      if ((kfds[i] = process_add_file(ends[i])) == -1)
+      {
+         if (i == 1)
+            close(kfds[0]);
+         else
+            file_close(ends[0]);
+         file_close(ends[1]);
+         return -1;
+      }
+   if (!copy_to_user(fds, kfds, sizeof kfds))
+      exit(-1);
+   return 0;
+}
+/*
+oldfd가 가리키는 파일을 newfd도 가리키게 합니다. newfd가 열려 있었으면 먼저 닫습니다.
+newfd가 0이나 1이면 그 뒤로 콘솔 대신 그 파일을 읽고 씁니다. 포크한 자식에게도 그대로 물려집니다.
+성공하면 newfd, oldfd가 열린 파일이 아니면 -1을 반환합니다.
+*/
+int dup2(int oldfd, int newfd)
+{
+   return process_dup2(oldfd, newfd);
+}
+/*
+ring의 제출 요청 하나(sqe)를 처리하고 결과를 반환합니다. 결과는 같은 일을 하는
+시스템 콜의 반환값과 같고, 반환값이 없는 close와 seek는 성공하면 0입니다.
+*/
+static int ring_do(const struct ring_sqe *sqe)
+{
+   struct iovec iov = {.iov_base = sqe->addr, .iov_len = sqe->len};
+   struct iov_iter it = {.iov = &iov, .cnt = 1, .ofs = 0, .left = sqe->len};
+   off_t pos = sqe->offset;
+
+   switch (sqe->opcode)
+   {
+   case RING_OP_NOP:
+      return 0;
+   case RING_OP_READ:
+      return do_read(sqe->fd, &it, pos < 0 ? NULL : &pos);
+   case RING_OP_WRITE:
+      return do_write(sqe->fd, &it, pos < 0 ? NULL : &pos);
+   case RING_OP_OPEN:
+      return open(sqe->addr);
+   case RING_OP_CLOSE:
+      if (process_get_file(sqe->fd) == NULL)
+         return -1;
+      close(sqe->fd);
+      return 0;
+   case RING_OP_SEEK:
+      if (pos < 0 || process_get_file(sqe->fd) == NULL)
+         return -1;
+      seek(sqe->fd, pos);
+      return 0;
+   default:
+      return -1;
+   }
+}
+/*
+ring의 제출 큐에 쌓인 요청을 최대 to_submit개까지 차례로 처리하고, 각각의 결과를
+완료 큐에 넣습니다. 처리한 요청 수를 반환하며, 완료 큐가 가득 차면 거기서 멈춥니다.
+완료 큐는 유저 메모리에 있으므로 프로세스는 시스템 콜 없이 결과를 거둘 수 있습니다.
+ring의 크기(mask + 1)가 2의 거듭제곱이 아니면 -1을 반환합니다.
+*/
+int ring_enter(struct io_ring *ring, unsigned to_submit)
+{
+   struct io_ring r;
+   unsigned submitted = 0;
+
+   if (!copy_from_user(&r, ring, sizeof r))
+      exit(-1);
+   if ((r.mask & (r.mask + 1)) != 0)
+      return -1;
+   while (submitted < to_submit && r.sq_head != r.sq_tail
+          && r.cq_tail - r.cq_head <= r.mask)
+   {
+      struct ring_sqe sqe;
+      struct ring_cqe cqe;
+
+      if (!copy_from_user(&sqe, &r.sqes[r.sq_head & r.mask], sizeof sqe))
+         exit(-1);
+      cqe.user_data = sqe.user_data;
+      cqe.res = ring_do(&sqe);
+      if (!copy_to_user(&r.cqes[r.cq_tail & r.mask], &cqe, sizeof cqe))
+         exit(-1);
+      r.sq_head++;
+      r.cq_tail++;
+      submitted++;
+   }
+   if (!copy_to_user(&ring->sq_head, &r.sq_head, sizeof r.sq_head)
+       || !copy_to_user(&ring->cq_tail, &r.cq_tail, sizeof r.cq_tail))
+      exit(-1);
+   return submitted;
+}
+/*
+유저 영역의 문자열 ustr을 새로 할당한 커널 페이지에 복사해 반환합니다.
+한 페이지보다 길면 잘라냅니다. 메모리가 부족하면 NULL을 반환하고,
+ustr이 올바른 유저 메모리가 아니면 프로세스를 종료합니다(exit(-1)).
 */
-void check_address(void *addr)
+static char *copy_in_string(const char *ustr)
 {
-   struct thread *curr = thread_current();
-   if (!is_user_vaddr(addr) || is_kernel_vaddr(addr) || pml4_get_page(curr->pml4, addr) == NULL)
+   char *str = palloc_get_page(0);
+   int64_t len;
+
+   if (str == NULL)
+      return NULL;
+   len = strncpy_from_user(str, ustr, PGSIZE);
+   if (len < 0)
    {
+      palloc_free_page(str);
       exit(-1);
    }
-}
\ No newline at end of file
+   if (len == PGSIZE)
+      str[PGSIZE - 1] = '\0';
+   return str;
+}
+/*
+유저 영역의 iovec 배열 iov[0..iovcnt)를 새로 할당한 커널 페이지에 복사해 반환하고,
+길이의 합을 *total에 저장합니다. iovcnt가 범위를 벗어나거나, 길이의 합이 int를 넘거나,
+메모리가 부족하면 NULL을 반환합니다. iov가 올바른 유저 메모리가 아니면 프로세스를 종료합니다.
+*/
+static struct iovec *copy_in_iovec(const struct iovec *iov, int iovcnt,
+                                   size_t *total)
+{
+   struct iovec *kiov;
+
+   if (iovcnt < 0 || iovcnt > IOV_MAX)
+      return NULL;
+   kiov = palloc_get_page(0);
+   if (kiov == NULL)
+      return NULL;
+   if (!copy_from_user(kiov, iov, iovcnt * sizeof *kiov))
+   {
+      palloc_free_page(kiov);
+      exit(-1);
+   }
+   *total = 0;
+   for (int i = 0; i < iovcnt; i++)
+   {
+      if (kiov[i].iov_len > (size_t)INT_MAX - *total)
+      {
+         palloc_free_page(kiov);
+         return NULL;
+      }
+      *total += kiov[i].iov_len;
+   }
+   return kiov;
+}
@@ -0,0 +1,118 @@
+/* usercopy.c: Copying data between kernel and user memory.
+ *
+ * System calls do not check user pointers page by page before using
+ * them.  They copy through the routines below instead, which touch user
+ * memory only at instructions listed in the exception table.  A page
+ * fault at one of those instructions that the VM cannot resolve resumes
+ * at the instruction's fixup instead of killing the process, and the copy
+ * reports failure.  So a buffer is validated once, by the copy itself,
+ * and a fault on a page that is merely not loaded yet is served as usual.
+ *
+ * This relies on CR0.WP, set in paging_init(), so that kernel writes to
+ * read-only and copy-on-write user pages fault as user writes do. */
+
+#include "userprog/usercopy.h"
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Exception table entry: a fault at INSN resumes at FIXUP. */
+struct exception_entry {
+	uint64_t insn;
+	uint64_t fixup;
+};
+
+/* Bounds of the exception table, from the linker script. */
+extern const struct exception_entry __start_ex_table[];
+extern const struct exception_entry __stop_ex_table[];
+
+/* Returns true if the SIZE bytes at UADDR lie entirely in user space. */
+static bool
+user_range_ok (const void *uaddr, size_t size) {
+	uint64_t start = (uint64_t) uaddr;
+	return start + size >= start && start + size <= KERN_BASE;
+}
+
+/* Copies SIZE bytes from SRC to DST, either of which may be in user
+ * memory, and returns the number of bytes not copied because of a fault. */
+static size_t
+copy_bytes (void *dst, const void *src, size_t size) {
+	asm volatile ("1: rep movsb\n"
+			"2:\n"
+			".pushsection __ex_table, \"a\"\n"
+			".quad 1b, 2b\n"
+			".popsection"
+			: "+D" (dst), "+S" (src), "+c" (size) : : "memory");
+	return size;
+}
+
+/* Reads the byte at user address USRC into *DST.  Returns false on a
+ * fault. */
+static inline bool
+get_user (uint8_t *dst, const uint8_t *usrc) {
+	bool ok = true;
+	uint8_t byte;
+
+	asm volatile ("1: movb (%[src]), %[byte]\n"
+			"2:\n"
+			".pushsection .text.fixup, \"ax\"\n"
+			"3: movb $0, %[ok]\n"
+			"jmp 2b\n"
+			".popsection\n"
+			".pushsection __ex_table, \"a\"\n"
+			".quad 1b, 3b\n"
+			".popsection"
+			: [ok] "+q" (ok), [byte] "=q" (byte) : [src] "r" (usrc));
+	*dst = byte;
+	return ok;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns false if
+ * some of them are not readable user memory. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	return user_range_ok (usrc, size) && copy_bytes (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns false if
+ * some of them are not writable user memory. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) {
+	return user_range_ok (udst, size) && copy_bytes (udst, src, size) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC into DST, which
+ * has room for SIZE bytes.  Returns the length of the string, or SIZE if
+ * it does not fit, in which case DST is not null-terminated.  Returns -1
+ * if the string runs into memory that is not readable user memory. */
+int64_t
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	const uint8_t *src = (const uint8_t *) usrc;
+	size_t i;
+
+	if (!is_user_vaddr (usrc))
+		return -1;
+	for (i = 0; i < size; i++) {
+		uint8_t c;
+
+		if (!is_user_vaddr (src + i) || !get_user (&c, src + i))
+			return -1;
+		dst[i] = c;
+		if (c == '\0')
+			return i;
+	}
+	return size;
+}
+
+/* If F is a fault at an instruction in the exception table, makes F
+ * resume at its fixup and returns true. */
+bool
+usercopy_fixup (struct intr_frame *f) {
+	const struct exception_entry *e;
+
+	for (e = __start_ex_table; e < __stop_ex_table; e++)
+		if (e->insn == f->rip) {
+			f->rip = e->fixup;
+			return true;
+		}
+	return false;
+}
@@ -1,7 +1,12 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
+#include <string.h>
+#include <syscall-nr.h>
 #include "vm/vm.h"
+#include "vm/swap.h"
 #include "devices/disk.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -20,8 +25,8 @@ static const struct page_operations anon_ops = {
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
-	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	swap_disk = disk_get (1, 1);
+	swap_init (swap_disk);
 }
 
 /* Initialize the file mapping */
@@ -31,22 +36,83 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->swap_slot = SWAP_SLOT_NONE;
+
+	/* Anonymous memory starts out zeroed; a lazy loader, if any, fills
+	 * in its part afterwards. */
+	memset (kva, 0, PGSIZE);
+	return true;
 }
 
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	size_t slot = anon_page->swap_slot;
+
+	if (slot == SWAP_SLOT_NONE)
+		return false;
+	swap_read (slot, kva, page->advice == MADV_RANDOM ? SWAP_RA_NEVER
+			: page->advice == MADV_SEQUENTIAL ? SWAP_RA_ALWAYS : SWAP_RA_AUTO);
+	page->owner->vm_stats.swap_ins++;
+	anon_page->swap_slot = SWAP_SLOT_NONE;
+	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.
+ * If PAGE shares its frame copy-on-write, the frame is written once and
+ * every page that maps it is left referring to the same slot. */
 static bool
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
+	struct frame *frame = page->frame;
+	void *kva = frame->kva;
+	unsigned ref_cnt = list_size (&frame->pages);
+	size_t slot;
+
+	slot = swap_alloc ();
+	if (slot == SWAP_SLOT_NONE)
+		return false;
+
+	/* Unmap first so that no owner can modify the page while it is being
+	 * written.  The pages stay linked to the frame until the write is
+	 * done, which makes their owners wait for it before swapping them
+	 * back in. */
+	for (struct list_elem *e = list_begin (&frame->pages);
+			e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *sharer = list_entry (e, struct page, frame_elem);
+		sharer->anon.swap_slot = slot;
+		if (sharer->owner->pml4 != NULL)
+			pml4_clear_page (sharer->owner->pml4, sharer->va);
+	}
+	vm_writeback_begin (frame);
+	swap_write (slot, kva, ref_cnt);
+	vm_writeback_end (frame);
+	while (!list_empty (&frame->pages))
+		vm_frame_unlink (vm_frame_page (frame));
+	return true;
+}
+
+/* Sets up DST, a new page, as a copy-on-write copy of SRC, an anonymous
+ * page of another process.  Sharing SRC's frame, if it has one, is up to
+ * the caller, which must hold the frame lock. */
+void
+anon_share (struct page *dst, struct page *src) {
+	dst->operations = &anon_ops;
+	dst->anon.swap_slot = src->anon.swap_slot;
+	if (dst->anon.swap_slot != SWAP_SLOT_NONE)
+		swap_ref (dst->anon.swap_slot);
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* Taking the frame lock waits out an eviction of PAGE in progress,
+	 * which may still be assigning its swap slot. */
+	bool locked = vm_frame_lock ();
+	vm_free_frame (page);
+	if (anon_page->swap_slot != SWAP_SLOT_NONE)
+		swap_free (anon_page->swap_slot);
+	vm_frame_unlock (locked);
 }
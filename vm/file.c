@@ -1,5 +1,11 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <round.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
@@ -14,45 +20,379 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* Frames holding pages of read-only executable segments, keyed by the
+ * file range they hold, so that processes running the same program map
+ * the same frames.  A frame leaves the table when the last page mapping
+ * it goes away.  Protected by the frame lock. */
+static struct hash text_frames;
+
+static uint64_t
+text_frame_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *f = hash_entry (e, struct frame, text_elem);
+	return hash_bytes (&f->text_inode, sizeof f->text_inode)
+		^ hash_int (f->text_ofs);
+}
+
+static bool
+text_frame_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, text_elem);
+	const struct frame *b = hash_entry (b_, struct frame, text_elem);
+
+	if (a->text_inode != b->text_inode)
+		return a->text_inode < b->text_inode;
+	if (a->text_ofs != b->text_ofs)
+		return a->text_ofs < b->text_ofs;
+	return a->text_bytes < b->text_bytes;
+}
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	if (!hash_init (&text_frames, text_frame_hash, text_frame_less, NULL))
+		PANIC ("vm_file_init: cannot allocate shared text table");
+}
+
+/* Returns a copy of INFO with its own handle to the same file, or a null
+ * pointer if memory runs out. */
+struct file_load_info *
+file_load_info_dup (const struct file_load_info *info) {
+	struct file_load_info *copy = malloc (sizeof *copy);
+	bool locked;
+
+	if (copy == NULL)
+		return NULL;
+	*copy = *info;
+	if (info->file != NULL) {
+		locked = vm_filesys_lock ();
+		copy->file = file_reopen (info->file);
+		vm_filesys_unlock (locked);
+		if (copy->file == NULL) {
+			free (copy);
+			return NULL;
+		}
+	}
+	return copy;
+}
+
+/* Frees INFO and closes the file handle it still owns, if any.
+ * INFO may be a null pointer. */
+void
+file_load_info_free (struct file_load_info *info) {
+	bool locked;
+
+	if (info == NULL)
+		return;
+	if (info->file != NULL) {
+		locked = vm_filesys_lock ();
+		file_close (info->file);
+		vm_filesys_unlock (locked);
+	}
+	free (info);
 }
 
 /* Initialize the file backed page */
 bool
 file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+	/* The uninit page's AUX shares storage with file_page, so fetch it
+	 * before setting up the handler. */
+	struct file_load_info *info = page->uninit.aux;
+
 	/* Set up the handler */
 	page->operations = &file_ops;
 
 	struct file_page *file_page = &page->file;
+	ASSERT (info != NULL && info->file != NULL);
+	*file_page = (struct file_page) {
+		.file = info->file,
+		.ofs = info->ofs,
+		.read_bytes = info->read_bytes,
+		.mapped_pages = info->mapped_pages,
+		.shared = info->shared,
+	};
+	info->file = NULL;
+	return true;
+}
+
+/* Reads PAGE's contents from its file into KVA and zeroes the part of
+ * the page past the end of the file. */
+static bool
+file_page_read (struct page *page, void *kva) {
+	struct file_page *file_page = &page->file;
+	bool locked = vm_filesys_lock ();
+	off_t bytes_read = file_read_at (file_page->file, kva,
+			file_page->read_bytes, file_page->ofs);
+	vm_filesys_unlock (locked);
+
+	if (bytes_read != (off_t) file_page->read_bytes)
+		return false;
+	memset ((uint8_t *) kva + file_page->read_bytes, 0,
+			PGSIZE - file_page->read_bytes);
+	return true;
+}
+
+/* Writes KVA, the contents of PAGE, back to its file if DIRTY. */
+static void
+file_page_writeback (struct page *page, void *kva, bool dirty) {
+	struct file_page *file_page = &page->file;
+
+	if (!dirty)
+		return;
+
+	bool locked = vm_filesys_lock ();
+	file_write_at (file_page->file, kva, file_page->read_bytes,
+			file_page->ofs);
+	vm_filesys_unlock (locked);
+}
+
+/* Returns true if PAGE is resident and the process has modified it. */
+static bool
+file_page_is_dirty (struct page *page) {
+	uint64_t *pml4 = page->owner->pml4;
+
+	return page->frame != NULL && pml4 != NULL
+		&& pml4_is_dirty (pml4, page->va);
+}
+
+/* Lazy loader of mmap pages and read-only executable segments. */
+bool
+file_load_page (struct page *page, void *aux UNUSED) {
+	return file_page_read (page, page->frame->kva);
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	return file_page_read (page, kva);
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.
+ * A frame of shared text is evicted for every process that maps it; such
+ * pages are read-only and thus never written back. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct frame *frame = page->frame;
+	bool dirty = file_page_is_dirty (page);
+
+	if (!dirty) {
+		while (!list_empty (&frame->pages))
+			vm_unmap_frame (vm_frame_page (frame));
+		return true;
+	}
+
+	/* Unmap before writing so that later stores fault instead of being
+	 * lost.  The page stays linked to the frame until the write is done,
+	 * which makes its owner wait for it before reading the page back. */
+	ASSERT (list_size (&frame->pages) == 1);
+	pml4_clear_page (page->owner->pml4, page->va);
+	vm_writeback_begin (frame);
+	file_page_writeback (page, frame->kva, true);
+	vm_writeback_end (frame);
+	vm_frame_unlink (page);
+	return true;
+}
+
+/* Writes PAGE, a resident file-backed page, back to its file if it is
+ * dirty, and leaves it resident and mapped.  Returns true if it wrote
+ * the page.  The caller must hold the frame lock and have pinned the
+ * page's frame; the lock is released during the write. */
+bool
+file_backed_clean (struct page *page) {
+	struct frame *frame = page->frame;
+
+	if (!file_page_is_dirty (page))
+		return false;
+
+	/* Clear the dirty bit first: a store during the write sets it again,
+	 * so the page is written once more later instead of being lost. */
+	pml4_set_dirty (page->owner->pml4, page->va, false);
+	vm_writeback_begin (frame);
+	file_page_writeback (page, frame->kva, true);
+	vm_writeback_end (frame);
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	/* The frame lock keeps the page from being evicted, and thus written
+	 * back a second time, while we write it back here. */
+	bool locked = vm_frame_lock ();
+	vm_writeback_wait (page);
+	if (page->frame != NULL)
+		file_page_writeback (page, page->frame->kva,
+				file_page_is_dirty (page));
+	vm_free_frame (page);
+	vm_frame_unlock (locked);
+
+	locked = vm_filesys_lock ();
+	file_close (file_page->file);
+	vm_filesys_unlock (locked);
+}
+
+/* Stores in KEY the file range that PAGE holds and returns true, if PAGE
+ * is a page of a read-only executable segment.  Otherwise returns
+ * false. */
+static bool
+text_key (struct page *page, struct frame *key) {
+	struct file *file;
+
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		struct file_load_info *info = page->uninit.aux;
+
+		if (VM_TYPE (page->uninit.type) != VM_FILE || info == NULL
+				|| info->file == NULL || !info->shared)
+			return false;
+		file = info->file;
+		key->text_ofs = info->ofs;
+		key->text_bytes = info->read_bytes;
+	} else {
+		if (page_get_type (page) != VM_FILE || !page->file.shared)
+			return false;
+		file = page->file.file;
+		key->text_ofs = page->file.ofs;
+		key->text_bytes = page->file.read_bytes;
+	}
+	key->text_inode = file_get_inode (file);
+	return true;
+}
+
+/* If PAGE, which is not resident, is a page of read-only text that some
+ * process already has in memory, maps PAGE to that frame and returns
+ * true.  Otherwise returns false.  The caller must hold the frame lock. */
+bool
+file_text_share (struct page *page) {
+	struct frame key, *frame;
+	struct hash_elem *e;
+
+	ASSERT (page->frame == NULL);
+	if (!text_key (page, &key))
+		return false;
+	e = hash_find (&text_frames, &key.text_elem);
+	if (e == NULL)
+		return false;
+	frame = hash_entry (e, struct frame, text_elem);
+
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		/* Turn PAGE into a file-backed page without reading it. */
+		struct file_load_info *info = page->uninit.aux;
+		file_backed_initializer (page, VM_FILE, frame->kva);
+		file_load_info_free (info);
+	}
+	vm_frame_link (frame, page);
+	if (!vm_page_map (page, frame->kva, false)) {
+		vm_frame_unlink (page);
+		return false;
+	}
+	return true;
 }
 
-/* Do the mmap */
+/* Adds the frame of PAGE, which has just been loaded, to the shared text
+ * table if PAGE is a page of read-only text.  The caller must hold the
+ * frame lock. */
+void
+file_text_register (struct page *page) {
+	struct frame *frame = page->frame;
+
+	if (frame->text_inode != NULL || !text_key (page, frame))
+		return;
+	if (hash_insert (&text_frames, &frame->text_elem) != NULL) {
+		/* Another process loaded the same page concurrently. */
+		frame->text_inode = NULL;
+	}
+}
+
+/* Removes FRAME, which no page maps any more, from the shared text table.
+ * The caller must hold the frame lock. */
+void
+file_text_forget (struct frame *frame) {
+	ASSERT (list_empty (&frame->pages));
+	if (frame->text_inode != NULL) {
+		hash_delete (&text_frames, &frame->text_elem);
+		frame->text_inode = NULL;
+	}
+}
+
+/* Returns the number of pages in the mapping that starts at PAGE, or 0
+ * if PAGE is not the first page of a mapping. */
+static size_t
+mmap_page_cnt (struct page *page) {
+	if (page_get_type (page) != VM_FILE)
+		return 0;
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		struct file_load_info *info = page->uninit.aux;
+		return info->mapped_pages;
+	}
+	return page->file.mapped_pages;
+}
+
+static bool
+mmap_remove_page (struct page *page, void *aux) {
+	spt_remove_page (aux, page);
+	return true;
+}
+
+/* Do the mmap.  If WRITABLE has MAP_POPULATE set, the mapping is loaded
+ * right away as if by madvise (MADV_WILLNEED). */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	uint8_t *end = (uint8_t *) addr + page_cnt * PGSIZE;
+	uint8_t *upage;
+	bool populate = (writable & MAP_POPULATE) != 0;
+	off_t file_len;
+	bool locked;
+
+	writable &= ~MAP_POPULATE;
+	if (addr == NULL || pg_ofs (addr) != 0 || length == 0
+			|| offset < 0 || offset % PGSIZE != 0
+			|| end <= (uint8_t *) addr || is_kernel_vaddr (end - 1)
+			|| !spt_range_is_free (spt, addr, end))
+		return NULL;
+
+	locked = vm_filesys_lock ();
+	file_len = file_length (file);
+	vm_filesys_unlock (locked);
+	if (file_len == 0)
+		return NULL;
+
+	for (upage = addr; upage < end; upage += PGSIZE) {
+		off_t ofs = offset + (upage - (uint8_t *) addr);
+		struct file_load_info src = {
+			.file = file,
+			.ofs = ofs,
+			.read_bytes = ofs >= file_len ? 0
+				: file_len - ofs < PGSIZE ? file_len - ofs : PGSIZE,
+			.mapped_pages = upage == addr ? page_cnt : 0,
+		};
+		struct file_load_info *info = file_load_info_dup (&src);
+
+		if (info == NULL || !vm_alloc_page_with_initializer (VM_FILE, upage,
+					writable, file_load_page, info)) {
+			file_load_info_free (info);
+			spt_for_each_range (spt, addr, upage, mmap_remove_page, spt);
+			return NULL;
+		}
+	}
+	if (populate)
+		vm_madvise (addr, length, MADV_WILLNEED);
+	return addr;
 }
 
 /* Do the munmap */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page = spt_find_page (spt, addr);
+	size_t page_cnt;
+
+	if (page == NULL || page->va != addr)
+		return;
+	page_cnt = mmap_page_cnt (page);
+	spt_for_each_range (spt, addr, (uint8_t *) addr + page_cnt * PGSIZE,
+			mmap_remove_page, spt);
 }
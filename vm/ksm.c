@@ -0,0 +1,157 @@
+/* ksm.c: Same-page merging for anonymous memory.
+ *
+ * When enabled with the "-ksm" kernel option, a background thread walks
+ * the frame table a batch of frames at a time, looking for anonymous
+ * frames with identical contents.  The pages of such frames are made to
+ * share one of them read-only, exactly as after fork(), and the other
+ * frames are freed.  A write to a merged page goes through vm_handle_wp(),
+ * which gives the writer its own copy again.
+ *
+ * Frames whose contents change between scans are not worth merging, so a
+ * frame only becomes a candidate once its checksum has stayed the same
+ * for a full pass.  Candidates are remembered in a small table indexed by
+ * checksum.  The table is only a hint: before merging, both frames are
+ * write-protected and compared byte by byte under the frame lock. */
+
+#include "vm/ksm.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* Number of slots in the candidate table. */
+#define KSM_BUCKETS 1024
+
+/* Frames scanned per wakeup, and ticks slept between wakeups. */
+#define KSM_BATCH 64
+#define KSM_SLEEP (TIMER_FREQ / 10)
+
+bool ksm_enabled;
+
+/* Candidate frames, by checksum.  Protected by the frame lock. */
+static struct frame *ksm_table[KSM_BUCKETS];
+
+/* Next frame table entry to scan. */
+static size_t ksm_cursor;
+
+/* Statistics. */
+static long long merge_cnt;     /* Frames freed by merging. */
+static long long unmerge_cnt;   /* Writes that broke a merged frame. */
+
+static void ksm_thread (void *aux);
+
+/* Starts the merging thread if it is enabled. */
+void
+ksm_init (void) {
+	if (ksm_enabled)
+		thread_create ("ksmd", PRI_MIN, ksm_thread, NULL);
+}
+
+/* Returns true if FRAME holds anonymous pages that may be merged. */
+static bool
+ksm_candidate (struct frame *frame) {
+	struct page *page = vm_frame_page (frame);
+
+	return page != NULL && frame->pin_cnt == 0
+		&& page_get_type (page) == VM_ANON;
+}
+
+/* Maps every page of FRAME read-only. */
+static void
+ksm_write_protect (struct frame *frame) {
+	for (struct list_elem *e = list_begin (&frame->pages);
+			e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		vm_page_map (page, frame->kva, false);
+	}
+}
+
+/* Moves the pages of DUP, whose contents equal KEEP's, over to KEEP and
+ * frees DUP. */
+static void
+ksm_merge (struct frame *keep, struct frame *dup) {
+	while (!list_empty (&dup->pages)) {
+		struct page *page = vm_frame_page (dup);
+		vm_frame_unlink (page);
+		vm_frame_link (keep, page);
+		vm_page_map (page, keep->kva, false);
+	}
+	keep->merged = true;
+	vm_frame_release (dup);
+	merge_cnt++;
+}
+
+/* Scans FRAME and merges it with an identical candidate, if there is
+ * one, or makes it a candidate itself. */
+static void
+ksm_scan_frame (struct frame *frame) {
+	bool locked = vm_frame_lock ();
+	struct frame **bucket, *other;
+	uint64_t checksum;
+
+	if (!ksm_candidate (frame))
+		goto done;
+
+	checksum = hash_bytes (frame->kva, PGSIZE);
+	if (checksum != frame->checksum) {
+		/* Changed since the last pass. */
+		frame->checksum = checksum;
+		goto done;
+	}
+
+	bucket = &ksm_table[checksum % KSM_BUCKETS];
+	other = *bucket;
+	if (other == frame)
+		goto done;
+	if (other == NULL || !ksm_candidate (other)
+			|| other->checksum != checksum) {
+		*bucket = frame;
+		goto done;
+	}
+
+	/* Once both frames are read-only, no process can change them behind
+	 * our back, so equal contents stay equal. */
+	ksm_write_protect (frame);
+	ksm_write_protect (other);
+	if (memcmp (frame->kva, other->kva, PGSIZE) == 0)
+		ksm_merge (other, frame);
+	else
+		*bucket = frame;
+
+done:
+	vm_frame_unlock (locked);
+}
+
+/* Merging thread.  Never exits. */
+static void
+ksm_thread (void *aux UNUSED) {
+	for (;;) {
+		size_t frame_cnt = vm_frame_cnt ();
+
+		for (size_t i = 0; i < KSM_BATCH && frame_cnt > 0; i++) {
+			ksm_scan_frame (vm_frame_at (ksm_cursor));
+			ksm_cursor = (ksm_cursor + 1) % frame_cnt;
+		}
+		timer_sleep (KSM_SLEEP);
+	}
+}
+
+/* Records that a write broke the sharing of a merged frame.  Called by
+ * vm_handle_wp() with the frame lock held. */
+void
+ksm_count_unmerge (void) {
+	unmerge_cnt++;
+}
+
+/* Prints merging statistics. */
+void
+ksm_print_stats (void) {
+	if (ksm_enabled)
+		printf ("KSM: %lld pages merged, %lld unmerged\n",
+				merge_cnt, unmerge_cnt);
+}
@@ -0,0 +1,102 @@
+/* reclaim.c: Background page reclaim.
+ *
+ * Without help, a page fault that finds the user pool empty has to evict
+ * a page itself, and if the victim is dirty the faulting process waits
+ * for it to be written out.  The reclaim thread keeps some frames free
+ * instead: once the number of free frames drops below the low watermark,
+ * it wakes up and evicts pages, with the same clock as a fault would,
+ * until the high watermark is reached again.  A fault only falls back to
+ * evicting directly when the pool is empty anyway.
+ *
+ * Evicting holds the frame lock only to pick, unmap and free the victim,
+ * not while writing it out, so faults elsewhere do not wait behind the
+ * reclaim thread's I/O.  After each pass the thread also writes back the
+ * dirty file-backed pages that the clock hand reaches next, so that they
+ * can be evicted later without any I/O.
+ *
+ * The watermarks scale with the size of the user pool. */
+
+#include "vm/reclaim.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* The low watermark is this fraction of the user pool, plus one. */
+#define RECLAIM_LOW_DIV 32
+
+/* Frames ahead of the clock hand scanned for dirty pages after a pass. */
+#define RECLAIM_CLEAN_SCAN 64
+
+bool reclaim_enabled = true;
+
+/* Wake up below LOW free frames, go back to sleep at HIGH. */
+static size_t reclaim_low;
+static size_t reclaim_high;
+
+/* Upped to wake the reclaim thread.  PENDING is true from then until the
+ * thread starts a pass, so that it is woken once per pass.  PENDING is
+ * protected by the frame lock. */
+static struct semaphore reclaim_sema;
+static bool reclaim_pending;
+
+/* Statistics. */
+static long long reclaim_cnt;   /* Frames freed in the background. */
+static long long direct_cnt;    /* Frames evicted by faulting threads. */
+static long long clean_cnt;     /* Dirty pages written back ahead of time. */
+
+static void reclaim_thread (void *aux);
+
+/* Starts the reclaim thread if it is enabled.  Must be called after the
+ * frame table is set up. */
+void
+reclaim_init (void) {
+	reclaim_low = vm_frame_cnt () / RECLAIM_LOW_DIV + 1;
+	reclaim_high = 2 * reclaim_low;
+	sema_init (&reclaim_sema, 0);
+	if (reclaim_enabled)
+		thread_create ("reclaimd", PRI_DEFAULT, reclaim_thread, NULL);
+}
+
+/* Wakes the reclaim thread if FREE_CNT frames free are too few.  Called
+ * by the frame allocator with the frame lock held. */
+void
+reclaim_check (size_t free_cnt) {
+	if (reclaim_enabled && free_cnt < reclaim_low && !reclaim_pending) {
+		reclaim_pending = true;
+		sema_up (&reclaim_sema);
+	}
+}
+
+/* Reclaim thread.  Never exits. */
+static void
+reclaim_thread (void *aux UNUSED) {
+	for (;;) {
+		bool locked;
+
+		sema_down (&reclaim_sema);
+		locked = vm_frame_lock ();
+		reclaim_pending = false;
+		vm_frame_unlock (locked);
+
+		while (vm_free_frame_cnt () < reclaim_high && vm_reclaim_frame ())
+			reclaim_cnt++;
+		clean_cnt += vm_clean_frames (RECLAIM_CLEAN_SCAN);
+	}
+}
+
+/* Records that a faulting thread had to evict a page itself.  Called by
+ * the frame allocator with the frame lock held. */
+void
+reclaim_count_direct (void) {
+	direct_cnt++;
+}
+
+/* Prints reclaim statistics. */
+void
+reclaim_print_stats (void) {
+	printf ("Reclaim: %lld pages reclaimed in the background, "
+			"%lld evicted directly, %lld cleaned\n",
+			reclaim_cnt, direct_cnt, clean_cnt);
+}
@@ -0,0 +1,338 @@
+/* swap.c: Swap slot manager for anonymous pages.
+ *
+ * The swap disk is divided into page-sized slots.  A slot is allocated
+ * with swap_alloc() when a page is evicted, filled by swap_write(), and
+ * read back by swap_read(), which also drops the reader's reference.
+ * A slot written for a frame shared copy-on-write starts out with one
+ * reference per sharer.
+ *
+ * Slots are handed out in clusters: consecutive allocations take
+ * consecutive slots of a run of SWAP_CLUSTER free slots, so pages that
+ * are evicted one after another end up next to each other on disk.  This
+ * only shapes the layout; each page is still written on its own when it
+ * is evicted.  It pays off on the way back in: when a swap-in follows the
+ * previous one on disk, the next SWAP_READAHEAD slots are read into a
+ * small cache as well, on the bet that the process is walking through
+ * memory that was evicted in the same order.  A madvise() hint on the
+ * page can force readahead on or off instead.
+ *
+ * Disk I/O happens without swap_lock held.  A slot is written before it
+ * gets its first reference, and is read only while a reference to it
+ * keeps it from being freed and reused, so its sectors do not change
+ * under the reader.
+ *
+ * If the compressed cache (zswap.c) is enabled, a page written to a slot
+ * may be kept compressed in memory instead, and only reaches the disk if
+ * the cache needs room.  The entries written back to make room keep an
+ * extra reference to their slots until they are on disk, like readahead
+ * entries. */
+
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
+
+/* Number of disk sectors that hold one page. */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Slots per allocation cluster. */
+#define SWAP_CLUSTER 16
+
+/* Slots read ahead of a sequential swap-in. */
+#define SWAP_READAHEAD 4
+
+static struct disk *swap_disk;
+
+/* Slots in use, and the number of pages referring to each.  A slot
+ * that is allocated but not yet written has no references. */
+static struct bitmap *swap_slots;
+static uint16_t *swap_refs;
+
+/* Slots [CLUSTER_NEXT, CLUSTER_END) are left in the current cluster. */
+static size_t cluster_next;
+static size_t cluster_end;
+
+/* Readahead cache.  An entry whose slot is SWAP_SLOT_NONE is empty. */
+struct readahead {
+	size_t slot;                /* Slot whose contents KVA holds. */
+	void *kva;                  /* Kernel page. */
+	bool busy;                  /* Still being read into KVA? */
+};
+static struct readahead readahead[SWAP_READAHEAD];
+static size_t readahead_victim; /* Next entry to replace. */
+static size_t last_read;        /* Slot of the last swap-in. */
+
+/* Protects everything above. */
+static struct lock swap_lock;
+
+/* Statistics. */
+static long long swap_in_cnt;   /* Pages swapped in. */
+static long long swap_out_cnt;  /* Pages swapped out. */
+static long long readahead_cnt; /* Pages read ahead. */
+static long long readahead_hit_cnt; /* Swap-ins served by readahead. */
+
+static void slot_write (size_t slot, const void *kva);
+static void slot_unref (size_t slot);
+
+/* Sets up swap on DISK, which may be a null pointer if there is no swap
+ * disk. */
+void
+swap_init (struct disk *disk) {
+	size_t slot_cnt = disk != NULL ? disk_size (disk) / SECTORS_PER_SLOT : 0;
+
+	swap_disk = disk;
+	swap_slots = bitmap_create (slot_cnt);
+	swap_refs = calloc (slot_cnt, sizeof *swap_refs);
+	if (swap_slots == NULL || (slot_cnt > 0 && swap_refs == NULL))
+		PANIC ("swap_init: cannot allocate swap slot table");
+	zswap_init (slot_cnt, slot_write);
+	for (size_t i = 0; i < SWAP_READAHEAD; i++) {
+		readahead[i].slot = SWAP_SLOT_NONE;
+		readahead[i].kva = palloc_get_page (PAL_ASSERT);
+		readahead[i].busy = false;
+	}
+	cluster_next = cluster_end = 0;
+	last_read = SWAP_SLOT_NONE;
+	lock_init (&swap_lock);
+}
+
+/* Starts a new cluster at the next run of SWAP_CLUSTER free slots after
+ * the current one, or, failing that, at any free slot.  Returns false if
+ * swap is full. */
+static bool
+cluster_refill (void) {
+	size_t start = bitmap_scan (swap_slots, cluster_end, SWAP_CLUSTER, false);
+	size_t cnt = SWAP_CLUSTER;
+
+	if (start == BITMAP_ERROR)
+		start = bitmap_scan (swap_slots, 0, SWAP_CLUSTER, false);
+	if (start == BITMAP_ERROR) {
+		start = bitmap_scan (swap_slots, 0, 1, false);
+		cnt = 1;
+	}
+	if (start == BITMAP_ERROR)
+		return false;
+	cluster_next = start;
+	cluster_end = start + cnt;
+	return true;
+}
+
+/* Allocates a swap slot.  Returns SWAP_SLOT_NONE if swap is full. */
+size_t
+swap_alloc (void) {
+	size_t slot = SWAP_SLOT_NONE;
+
+	lock_acquire (&swap_lock);
+	if ((cluster_next < cluster_end && !bitmap_test (swap_slots, cluster_next))
+			|| cluster_refill ()) {
+		slot = cluster_next++;
+		bitmap_mark (swap_slots, slot);
+	}
+	lock_release (&swap_lock);
+	return slot;
+}
+
+/* Reads SLOT from disk into KVA. */
+static void
+slot_read (size_t slot, void *kva) {
+	for (size_t i = 0; i < SECTORS_PER_SLOT; i++)
+		disk_read (swap_disk, slot * SECTORS_PER_SLOT + i,
+				(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+}
+
+/* Writes the page at KVA to SLOT on disk. */
+static void
+slot_write (size_t slot, const void *kva) {
+	for (size_t i = 0; i < SECTORS_PER_SLOT; i++)
+		disk_write (swap_disk, slot * SECTORS_PER_SLOT + i,
+				(const uint8_t *) kva + i * DISK_SECTOR_SIZE);
+}
+
+/* Returns the readahead entry holding SLOT, or being filled with it, or a
+ * null pointer. */
+static struct readahead *
+readahead_find (size_t slot) {
+	for (size_t i = 0; i < SWAP_READAHEAD; i++)
+		if (readahead[i].slot == slot)
+			return &readahead[i];
+	return NULL;
+}
+
+/* Writes the page at KVA to SLOT, a slot returned by swap_alloc(), on
+ * behalf of REF_CNT pages. */
+void
+swap_write (size_t slot, const void *kva, unsigned ref_cnt) {
+	ASSERT (ref_cnt > 0);
+
+	struct list victims;
+	struct list_elem *e;
+	bool stored;
+
+	list_init (&victims);
+	lock_acquire (&swap_lock);
+	ASSERT (bitmap_test (swap_slots, slot) && swap_refs[slot] == 0);
+	stored = zswap_store (slot, kva, &victims);
+	if (stored) {
+		swap_refs[slot] = ref_cnt;
+		swap_out_cnt++;
+	}
+	for (e = list_begin (&victims); e != list_end (&victims);
+			e = list_next (e))
+		swap_refs[zswap_victim_slot (e)]++;
+	lock_release (&swap_lock);
+
+	/* Nobody reads SLOT until it has references. */
+	if (!stored) {
+		slot_write (slot, kva);
+		lock_acquire (&swap_lock);
+		swap_refs[slot] = ref_cnt;
+		swap_out_cnt++;
+		lock_release (&swap_lock);
+	}
+
+	/* Until the victims are dropped, swap-ins of their slots are still
+	 * served from the cache. */
+	if (!list_empty (&victims)) {
+		zswap_write_victims (&victims);
+		lock_acquire (&swap_lock);
+		while (!list_empty (&victims))
+			slot_unref (zswap_victim_done (list_pop_front (&victims)));
+		lock_release (&swap_lock);
+	}
+}
+
+/* Returns the next readahead entry to fill, or a null pointer if all of
+ * them are busy. */
+static struct readahead *
+readahead_claim (void) {
+	for (size_t i = 0; i < SWAP_READAHEAD; i++) {
+		struct readahead *ra = &readahead[readahead_victim];
+
+		readahead_victim = (readahead_victim + 1) % SWAP_READAHEAD;
+		if (!ra->busy)
+			return ra;
+	}
+	return NULL;
+}
+
+/* Reserves readahead entries for the slots that follow SLOT and need
+ * disk I/O, storing them in BATCH, and returns how many it reserved.
+ * Each reserved slot gets an extra reference, which the caller drops
+ * once it has read the slot.  Must be called with swap_lock held. */
+static size_t
+readahead_reserve (size_t slot, struct readahead *batch[]) {
+	size_t cnt = 0;
+
+	for (size_t next = slot + 1; next <= slot + SWAP_READAHEAD
+			&& next < bitmap_size (swap_slots); next++) {
+		struct readahead *ra;
+
+		/* Skip slots that are free or still being written, and
+		 * those that need no disk I/O. */
+		if (swap_refs[next] == 0 || readahead_find (next) != NULL
+				|| zswap_contains (next))
+			continue;
+		ra = readahead_claim ();
+		if (ra == NULL)
+			break;
+		ra->slot = next;
+		ra->busy = true;
+		swap_refs[next]++;
+		batch[cnt++] = ra;
+	}
+	return cnt;
+}
+
+/* Reads SLOT into KVA and drops a reference to it.  Also reads the slots
+ * after it into the readahead cache as RA_MODE says; with SWAP_RA_AUTO,
+ * if SLOT follows the slot last read. */
+void
+swap_read (size_t slot, void *kva, enum swap_readahead ra_mode) {
+	struct readahead *batch[SWAP_READAHEAD];
+	size_t batch_slots[SWAP_READAHEAD];
+	size_t batch_cnt = 0;
+	struct readahead *ra;
+	bool loaded = true;
+
+	lock_acquire (&swap_lock);
+	ASSERT (bitmap_test (swap_slots, slot) && swap_refs[slot] > 0);
+	swap_in_cnt++;
+
+	ra = readahead_find (slot);
+	if (ra != NULL && !ra->busy) {
+		memcpy (kva, ra->kva, PGSIZE);
+		readahead_hit_cnt++;
+	} else if (!zswap_load (slot, kva))
+		loaded = false;
+
+	if (ra_mode == SWAP_RA_ALWAYS
+			|| (ra_mode == SWAP_RA_AUTO && slot == last_read + 1))
+		batch_cnt = readahead_reserve (slot, batch);
+	last_read = slot;
+	lock_release (&swap_lock);
+
+	if (!loaded)
+		slot_read (slot, kva);
+	for (size_t i = 0; i < batch_cnt; i++) {
+		batch_slots[i] = batch[i]->slot;
+		slot_read (batch_slots[i], batch[i]->kva);
+	}
+
+	if (batch_cnt > 0) {
+		lock_acquire (&swap_lock);
+		for (size_t i = 0; i < batch_cnt; i++)
+			batch[i]->busy = false;
+		readahead_cnt += batch_cnt;
+		lock_release (&swap_lock);
+		for (size_t i = 0; i < batch_cnt; i++)
+			swap_free (batch_slots[i]);
+	}
+	swap_free (slot);
+}
+
+/* Adds a reference to SLOT. */
+void
+swap_ref (size_t slot) {
+	lock_acquire (&swap_lock);
+	ASSERT (bitmap_test (swap_slots, slot) && swap_refs[slot] > 0);
+	swap_refs[slot]++;
+	lock_release (&swap_lock);
+}
+
+/* Drops a reference to SLOT and frees the slot with the last one.  Must
+ * be called with swap_lock held. */
+static void
+slot_unref (size_t slot) {
+	struct readahead *ra;
+
+	ASSERT (bitmap_test (swap_slots, slot) && swap_refs[slot] > 0);
+	if (--swap_refs[slot] == 0) {
+		bitmap_reset (swap_slots, slot);
+		zswap_forget (slot);
+		ra = readahead_find (slot);
+		if (ra != NULL)
+			ra->slot = SWAP_SLOT_NONE;
+	}
+}
+
+/* Drops a reference to SLOT and frees the slot with the last one. */
+void
+swap_free (size_t slot) {
+	lock_acquire (&swap_lock);
+	slot_unref (slot);
+	lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void) {
+	printf ("Swap: %lld pages in, %lld out, %lld read ahead (%lld hits)\n",
+			swap_in_cnt, swap_out_cnt, readahead_cnt, readahead_hit_cnt);
+}
@@ -2,4 +2,8 @@ vm_SRC = vm/vm.c          # Main api proxy
 vm_SRC += vm/uninit.c     # Uninitialized page
 vm_SRC += vm/anon.c       # Anonymous page
 vm_SRC += vm/file.c       # File mapped page
+vm_SRC += vm/swap.c       # Swap slot manager
+vm_SRC += vm/zswap.c      # Compressed swap cache
+vm_SRC += vm/ksm.c        # Same-page merging
+vm_SRC += vm/reclaim.c    # Background page reclaim
 vm_SRC += vm/inspect.c    # Testing utility
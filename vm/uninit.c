@@ -51,9 +51,13 @@ uninit_initialize (struct page *page, void *kva) {
 	vm_initializer *init = uninit->init;
 	void *aux = uninit->aux;
 
-	/* TODO: You may need to fix this function. */
-	return uninit->page_initializer (page, uninit->type, kva) &&
+	/* AUX, if any, is a file_load_info owned by this page.  The page
+	 * initializer may take over its file handle; whatever is left is
+	 * released here once the contents are in place. */
+	bool success = uninit->page_initializer (page, uninit->type, kva) &&
 		(init ? init (page, aux) : true);
+	file_load_info_free (aux);
+	return success;
 }
 
 /* Free the resources hold by uninit_page. Although most of pages are transmuted
@@ -62,7 +66,7 @@ uninit_initialize (struct page *page, void *kva) {
  * PAGE will be freed by the caller. */
 static void
 uninit_destroy (struct page *page) {
-	struct uninit_page *uninit UNUSED = &page->uninit;
-	/* TODO: Fill this function.
-	 * TODO: If you don't have anything to do, just return. */
+	struct uninit_page *uninit = &page->uninit;
+
+	file_load_info_free (uninit->aux);
 }
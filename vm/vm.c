@@ -1,8 +1,87 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/ksm.h"
+#include "vm/reclaim.h"
+#include "vm/swap.h"
+
+/* The frame table: one entry for each page of the user pool, indexed by
+ * the page's position in the pool, so that finding the frame of a kernel
+ * virtual address is a subtraction.  An entry that no page maps is
+ * either free in the pool or between owners. */
+static struct frame *frame_table;
+static size_t frame_cnt;
+static uint8_t *frame_base;
+
+/* Position of the clock hand in FRAME_TABLE. */
+static size_t clock_hand;
+
+/* Number of frames free in the user pool. */
+static size_t free_frame_cnt;
+
+/* Protects the frame table and the frame <-> page links. */
+static struct lock frame_lock;
+
+/* Signaled, with frame_lock, when a frame's write-out completes. */
+static struct condition writeback_done;
+
+/* Returns the frame table entry for KVA, a page of the user pool. */
+static struct frame *
+frame_of (void *kva) {
+	size_t idx = ((uint8_t *) kva - frame_base) / PGSIZE;
+
+	ASSERT (pg_ofs (kva) == 0);
+	ASSERT (idx < frame_cnt);
+	return &frame_table[idx];
+}
+
+/* Returns the number of entries in the frame table. */
+size_t
+vm_frame_cnt (void) {
+	return frame_cnt;
+}
+
+/* Returns the number of frames free in the user pool.  Without the frame
+ * lock held, the result is only a snapshot. */
+size_t
+vm_free_frame_cnt (void) {
+	return free_frame_cnt;
+}
+
+/* Returns entry IDX of the frame table.  Its contents may only be
+ * examined with the frame lock held. */
+struct frame *
+vm_frame_at (size_t idx) {
+	ASSERT (idx < frame_cnt);
+	return &frame_table[idx];
+}
+
+/* Sets up the frame table over the user pool. */
+static void
+frame_table_init (void) {
+	size_t table_pages;
+
+	palloc_user_pool_range ((void **) &frame_base, &frame_cnt);
+	table_pages = DIV_ROUND_UP (frame_cnt * sizeof *frame_table, PGSIZE);
+	frame_table = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, table_pages);
+	for (size_t i = 0; i < frame_cnt; i++) {
+		frame_table[i].kva = frame_base + i * PGSIZE;
+		list_init (&frame_table[i].pages);
+	}
+	clock_hand = 0;
+	free_frame_cnt = frame_cnt;
+	lock_init (&frame_lock);
+	cond_init (&writeback_done);
+}
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -15,7 +94,9 @@ vm_init (void) {
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+	frame_table_init ();
+	ksm_init ();
+	reclaim_init ();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -36,6 +117,14 @@ page_get_type (struct page *page) {
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static struct frame *vm_get_frame_from_pool (bool evict);
+static void vm_stack_growth (void *addr);
+static bool vm_handle_wp (struct page *page);
+static bool vm_share_text (struct page *page);
+static void vm_loaded_page (struct page *page);
+static bool vm_pin_page (struct page *page, bool write);
+static bool vm_fault_in (struct page *page);
+static void vm_unpin_page (struct page *page);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -47,97 +136,778 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 	ASSERT (VM_TYPE(type) != VM_UNINIT)
 
 	struct supplemental_page_table *spt = &thread_current ()->spt;
+	bool (*initializer) (struct page *, enum vm_type, void *kva);
+	struct page *page;
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
-		/* TODO: Create the page, fetch the initialier according to the VM type,
-		 * TODO: and then create "uninit" page struct by calling uninit_new. You
-		 * TODO: should modify the field after calling the uninit_new. */
+		switch (VM_TYPE (type)) {
+			case VM_ANON:
+				initializer = anon_initializer;
+				break;
+			case VM_FILE:
+				initializer = file_backed_initializer;
+				break;
+			default:
+				goto err;
+		}
+
+		page = malloc (sizeof *page);
+		if (page == NULL)
+			goto err;
+		uninit_new (page, pg_round_down (upage), init, type, aux, initializer);
+		page->writable = writable;
+		page->owner = thread_current ();
+		page->advice = MADV_NORMAL;
 
-		/* TODO: Insert the page into the spt. */
+		if (!spt_insert_page (spt, page)) {
+			free (page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
 }
 
+/* Shift of the address bits that index each level of the SPT radix tree,
+ * from the root (PML4) down to the leaves (PTX). */
+static const unsigned spt_shift[SPT_LEVELS] = {
+	PML4SHIFT, PDPESHIFT, PDXSHIFT, PTXSHIFT
+};
+
+#define spt_index(va, level) \
+	((((uint64_t) (va)) >> spt_shift[level]) & (SPT_FANOUT - 1))
+
+/* Returns the leaf slot for VA in SPT.  If an interior node on the way
+ * is missing, allocates it when CREATE is true and returns NULL
+ * otherwise (or when the allocation fails). */
+static void **
+spt_walk (struct supplemental_page_table *spt, const void *va, bool create) {
+	struct spt_node **node = &spt->root;
+
+	for (int level = 0; ; level++) {
+		if (*node == NULL) {
+			if (!create)
+				return NULL;
+			*node = palloc_get_page (PAL_ZERO);
+			if (*node == NULL)
+				return NULL;
+		}
+
+		void **slot = &(*node)->slots[spt_index (va, level)];
+		if (level == SPT_LEVELS - 1)
+			return slot;
+		node = (struct spt_node **) slot;
+	}
+}
+
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	if (is_kernel_vaddr (va))
+		return NULL;
 
-	return page;
+	void **slot = spt_walk (spt, va, false);
+	return slot != NULL ? *slot : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: Fill this function. */
+spt_insert_page (struct supplemental_page_table *spt, struct page *page) {
+	ASSERT (pg_ofs (page->va) == 0);
+
+	if (is_kernel_vaddr (page->va))
+		return false;
 
-	return succ;
+	void **slot = spt_walk (spt, page->va, true);
+	if (slot == NULL || *slot != NULL)
+		return false;
+
+	*slot = page;
+	return true;
 }
 
+/* Remove PAGE from spt and free it.  Interior nodes that become empty are
+ * kept until the whole table is killed, which keeps removal O(1) and makes
+ * it safe to call from within spt_for_each_range(). */
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	void **slot = spt_walk (spt, page->va, false);
+
+	ASSERT (slot != NULL && *slot == page);
+	*slot = NULL;
 	vm_dealloc_page (page);
+}
+
+/* Calls FUNC on every page of NODE, a node at LEVEL covering the
+ * addresses from BASE, that lies within [START, END).  Empty subtrees
+ * are skipped without being descended into. */
+static bool
+spt_node_for_each (struct spt_node *node, int level, uint64_t base,
+		uint64_t start, uint64_t end, spt_range_func *func, void *aux) {
+	uint64_t span = 1ULL << spt_shift[level];
+
+	for (size_t i = 0; i < SPT_FANOUT; i++) {
+		uint64_t lo = base + i * span;
+		if (lo >= end)
+			break;
+		if (lo + span <= start || node->slots[i] == NULL)
+			continue;
+
+		if (level == SPT_LEVELS - 1) {
+			if (!func (node->slots[i], aux))
+				return false;
+		} else if (!spt_node_for_each (node->slots[i], level + 1, lo,
+					start, end, func, aux))
+			return false;
+	}
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Calls FUNC for each page in SPT whose address lies within [START, END),
+ * in ascending address order.  FUNC may remove the page it is given.
+ * Returns false as soon as FUNC does, true otherwise. */
+bool
+spt_for_each_range (struct supplemental_page_table *spt, void *start,
+		void *end, spt_range_func *func, void *aux) {
+	if (spt->root == NULL || (uint64_t) start >= (uint64_t) end)
+		return true;
+	return spt_node_for_each (spt->root, 0, 0, (uint64_t) start,
+			(uint64_t) end, func, aux);
+}
+
+static bool
+spt_range_occupied (struct page *page UNUSED, void *aux UNUSED) {
+	return false;
+}
+
+/* Returns true if no page of SPT lies within [START, END). */
+bool
+spt_range_is_free (struct supplemental_page_table *spt, void *start,
+		void *end) {
+	return spt_for_each_range (spt, start, end, spt_range_occupied, NULL);
+}
+
+/* Returns the first page mapping FRAME, or a null pointer if the frame is
+ * free. */
+struct page *
+vm_frame_page (struct frame *frame) {
+	if (list_empty (&frame->pages))
+		return NULL;
+	return list_entry (list_front (&frame->pages), struct page, frame_elem);
+}
+
+/* Returns true if any page mapping FRAME has been accessed since the
+ * last call, and clears the accessed bits. */
+static bool
+frame_test_and_clear_accessed (struct frame *frame) {
+	bool accessed = false;
+
+	for (struct list_elem *e = list_begin (&frame->pages);
+			e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (pml4_is_accessed (pml4, page->va)) {
+			pml4_set_accessed (pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* Returns true if PAGE can be evicted without any I/O, that is, if it is
+ * a file-backed page whose contents still match the file. */
+static bool
+frame_is_clean (struct page *page) {
+	return page_get_type (page) == VM_FILE
+		&& !pml4_is_dirty (page->owner->pml4, page->va);
+}
+
+/* Get the struct frame, that will be evicted.
+ *
+ * Second-chance clock over the frame table: a frame whose page was
+ * accessed since the hand last passed has its accessed bit cleared and is
+ * skipped.  During the first revolution only clean file-backed pages are
+ * taken, since dropping them costs no I/O; the first unaccessed page that
+ * would need writing out is remembered and taken once the revolution
+ * completes.  A second revolution finds some page whose accessed bit the
+ * first one cleared, so the hand never moves more than twice around the
+ * table.  Returns NULL only if every frame is pinned.  The caller must
+ * hold frame_lock. */
 static struct frame *
 vm_get_victim (void) {
-	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
+	struct frame *fallback = NULL;
 
-	return victim;
+	for (size_t n = 0; n < 2 * frame_cnt; n++) {
+		struct frame *frame = &frame_table[clock_hand];
+		struct page *page = vm_frame_page (frame);
+
+		if (n == frame_cnt && fallback != NULL)
+			return fallback;
+		clock_hand = (clock_hand + 1) % frame_cnt;
+		if (page == NULL || frame->pin_cnt > 0
+				|| frame_test_and_clear_accessed (frame))
+			continue;
+		if (n >= frame_cnt || frame_is_clean (page))
+			return frame;
+		if (fallback == NULL)
+			fallback = frame;
+	}
+	return fallback;
 }
 
-/* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+/* Evict one page and return the corresponding frame, still pinned.
+ * Return NULL if no frame can be evicted, because every frame is pinned
+ * or swap is full. */
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
+	struct frame *victim = vm_get_victim ();
+	struct page *page;
+
+	if (victim == NULL)
+		return NULL;
+
+	/* Keep the victim out of the clock's reach while its contents are
+	 * written out.  swap_out() unmaps the page and releases frame_lock
+	 * for the I/O with vm_writeback_begin(), so other faults go ahead
+	 * while the owner of the page waits for it in vm_writeback_wait().
+	 * For a frame shared copy-on-write, swap_out() of one page evicts it
+	 * for every page that maps it. */
+	victim->pin_cnt++;
+	page = vm_frame_page (victim);
+	if (!swap_out (page)) {
+		victim->pin_cnt--;
+		return NULL;
+	}
+	file_text_forget (victim);
+	return victim;
+}
 
-	return NULL;
+/* Evicts one page ahead of need and returns its frame to the user pool.
+ * Called by the reclaim thread.  Holds frame_lock only to pick and unmap
+ * the victim and to release its frame, not while writing it out.
+ * Returns false if no frame could be evicted. */
+bool
+vm_reclaim_frame (void) {
+	struct frame *victim;
+
+	lock_acquire (&frame_lock);
+	victim = vm_evict_frame ();
+	if (victim != NULL)
+		vm_frame_release (victim);
+	lock_release (&frame_lock);
+	return victim != NULL;
+}
+
+/* Writes back the dirty file-backed pages among the next SCAN_CNT frames
+ * that the clock hand will reach, leaving them resident, so that evicting
+ * them later costs no I/O.  Called by the reclaim thread.  Returns the
+ * number of pages written. */
+size_t
+vm_clean_frames (size_t scan_cnt) {
+	size_t cleaned = 0;
+	size_t hand;
+
+	lock_acquire (&frame_lock);
+	hand = clock_hand;
+	for (size_t n = 0; n < scan_cnt && n < frame_cnt; n++) {
+		struct frame *frame = &frame_table[(hand + n) % frame_cnt];
+		struct page *page = vm_frame_page (frame);
+
+		if (page == NULL || frame->pin_cnt > 0
+				|| page_get_type (page) != VM_FILE || frame_is_clean (page))
+			continue;
+		frame->pin_cnt++;
+		if (file_backed_clean (page))
+			cleaned++;
+		frame->pin_cnt--;
+	}
+	lock_release (&frame_lock);
+	return cleaned;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * space.
+ *
+ * The returned frame is pinned so that it cannot be evicted before the
+ * caller has filled it; unpin it once the page is mapped. */
 static struct frame *
 vm_get_frame (void) {
+	return vm_get_frame_from_pool (true);
+}
+
+/* Returns a pinned frame like vm_get_frame(), but only if the user pool
+ * has one free: instead of evicting a page, returns a null pointer. */
+static struct frame *
+vm_get_free_frame (void) {
+	return vm_get_frame_from_pool (false);
+}
+
+/* Implements vm_get_frame() and, if EVICT is false, vm_get_free_frame(). */
+static struct frame *
+vm_get_frame_from_pool (bool evict) {
 	struct frame *frame = NULL;
-	/* TODO: Fill this function. */
+	void *kva;
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	lock_acquire (&frame_lock);
+	kva = palloc_get_page (PAL_USER);
+	if (kva != NULL) {
+		frame = frame_of (kva);
+		free_frame_cnt--;
+	} else if (evict) {
+		/* The reclaim thread fell behind: evict directly. */
+		frame = vm_evict_frame ();
+		if (frame == NULL)
+			PANIC ("vm_get_frame: out of user frames");
+		reclaim_count_direct ();
+	}
+	reclaim_check (free_frame_cnt);
+	if (frame != NULL) {
+		ASSERT (list_empty (&frame->pages) && frame->text_inode == NULL);
+		frame->pin_cnt = 1;
+		frame->checksum = 0;
+		frame->merged = false;
+		frame->writeback = false;
+	}
+	lock_release (&frame_lock);
 	return frame;
 }
 
+/* Acquires the frame table lock unless the current thread already holds
+ * it, and returns whether it did.  Pass the result to vm_frame_unlock().
+ * Holding the lock keeps the clock from evicting any page. */
+bool
+vm_frame_lock (void) {
+	if (lock_held_by_current_thread (&frame_lock))
+		return false;
+	lock_acquire (&frame_lock);
+	return true;
+}
+
+void
+vm_frame_unlock (bool acquired) {
+	if (acquired)
+		lock_release (&frame_lock);
+}
+
+/* Maps PAGE to KVA in its owner's page table, replacing any previous
+ * mapping.  Clearing the old entry first flushes it from the TLB if the
+ * owner's page table is active. */
+bool
+vm_page_map (struct page *page, void *kva, bool writable) {
+	uint64_t *pml4 = page->owner->pml4;
+
+	pml4_clear_page (pml4, page->va);
+	return pml4_set_page (pml4, page->va, kva, writable);
+}
+
+/* Makes PAGE map FRAME.  The caller must hold the frame lock. */
+void
+vm_frame_link (struct frame *frame, struct page *page) {
+	struct vm_stats *stats = &page->owner->vm_stats;
+
+	list_push_back (&frame->pages, &page->frame_elem);
+	page->frame = frame;
+	if (++stats->rss > stats->peak_rss)
+		stats->peak_rss = stats->rss;
+}
+
+/* Undoes vm_frame_link() for PAGE, leaving its page table entry alone.
+ * The caller must hold the frame lock. */
+void
+vm_frame_unlink (struct page *page) {
+	ASSERT (page->frame != NULL);
+	list_remove (&page->frame_elem);
+	page->frame = NULL;
+	page->owner->vm_stats.rss--;
+}
+
+/* Unmaps PAGE from its owner's page table and breaks the link between
+ * PAGE and its frame.  The frame stays allocated even if no page maps it
+ * any more.  Used by the swap_out() implementations once they have saved
+ * the contents. */
+void
+vm_unmap_frame (struct page *page) {
+	ASSERT (page->frame != NULL);
+	if (page->owner->pml4 != NULL)
+		pml4_clear_page (page->owner->pml4, page->va);
+	vm_frame_unlink (page);
+}
+
+/* Unmaps PAGE from its owner's page table and returns the frame that
+ * holds it to the user pool, unless other pages still share it.  Does
+ * nothing if PAGE is not resident. */
+void
+vm_free_frame (struct page *page) {
+	bool locked = vm_frame_lock ();
+	struct frame *frame;
+
+	vm_writeback_wait (page);
+	frame = page->frame;
+	if (frame != NULL) {
+		vm_unmap_frame (page);
+		if (list_empty (&frame->pages))
+			vm_frame_release (frame);
+	}
+	vm_frame_unlock (locked);
+}
+
+/* Marks FRAME, which the caller has pinned, as being written out and
+ * releases the frame lock for the I/O.  Pages that map FRAME must be
+ * unmapped first unless they may keep using it during the write.  The
+ * caller must hold the frame lock. */
+void
+vm_writeback_begin (struct frame *frame) {
+	ASSERT (frame->pin_cnt > 0 && !frame->writeback);
+	frame->writeback = true;
+	lock_release (&frame_lock);
+}
+
+/* Reacquires the frame lock after the write-out of FRAME begun by
+ * vm_writeback_begin() and wakes the threads waiting for it.  They do not
+ * run before the caller releases the lock, so it may still finish the
+ * eviction of FRAME first. */
+void
+vm_writeback_end (struct frame *frame) {
+	lock_acquire (&frame_lock);
+	frame->writeback = false;
+	cond_broadcast (&writeback_done, &frame_lock);
+}
+
+/* Waits until no write-out of PAGE's frame is in progress.  Pages that
+ * an eviction is writing out are still linked to their frame until it
+ * completes, so afterward PAGE is either resident and usable or
+ * evicted.  The caller must hold the frame lock. */
+void
+vm_writeback_wait (struct page *page) {
+	while (page->frame != NULL && page->frame->writeback)
+		cond_wait (&writeback_done, &frame_lock);
+}
+
+/* Returns FRAME, which no page maps any more, to the user pool.  The
+ * caller must hold the frame lock. */
+void
+vm_frame_release (struct frame *frame) {
+	ASSERT (list_empty (&frame->pages));
+	file_text_forget (frame);
+	frame->pin_cnt = 0;
+	palloc_free_page (frame->kva);
+	free_frame_cnt++;
+}
+
+/* Evicts PAGE ahead of memory pressure, saving its contents the way the
+ * clock would, and returns its frame to the user pool.  Pinned frames and
+ * frames that other pages share are left alone.  Returns true if the
+ * frame was freed. */
+bool
+vm_reclaim_page (struct page *page) {
+	bool locked = vm_frame_lock ();
+	struct frame *frame = page->frame;
+	bool reclaimed = false;
+
+	if (frame != NULL && frame->pin_cnt == 0
+			&& list_size (&frame->pages) == 1) {
+		frame->pin_cnt++;
+		reclaimed = swap_out (page);
+		if (reclaimed)
+			vm_frame_release (frame);
+		else
+			frame->pin_cnt--;
+	}
+	vm_frame_unlock (locked);
+	return reclaimed;
+}
+
+/* Loads PAGE if it is not resident and pins its frame.  If WRITE is true,
+ * also makes sure that the frame is PAGE's own, so that the kernel may
+ * store into it through the user mapping.  Returns false if the page
+ * cannot be loaded. */
+static bool
+vm_pin_page (struct page *page, bool write) {
+	/* The page may be evicted again between claiming and pinning it, so
+	 * check under the lock. */
+	while (true) {
+		lock_acquire (&frame_lock);
+		vm_writeback_wait (page);
+		if (page->frame != NULL && (!write
+					|| list_size (&page->frame->pages) == 1)) {
+			page->frame->pin_cnt++;
+			lock_release (&frame_lock);
+			return true;
+		}
+		lock_release (&frame_lock);
+		if (page->frame != NULL ? !vm_handle_wp (page)
+				: !vm_do_claim_page (page))
+			return false;
+	}
+}
+
+/* Makes PAGE's frame, if any, eligible for eviction again. */
+static void
+vm_unpin_page (struct page *page) {
+	lock_acquire (&frame_lock);
+	if (page->frame != NULL) {
+		ASSERT (page->frame->pin_cnt > 0);
+		page->frame->pin_cnt--;
+	}
+	lock_release (&frame_lock);
+}
+
+/* Returns true if ADDR may be reached by growing the stack of a process
+ * whose stack pointer is RSP: it must lie within USER_STACK_LIMIT of
+ * USER_STACK and not below what a PUSH at RSP would touch. */
+bool
+vm_is_stack_access (void *addr, void *rsp) {
+	return (uint8_t *) addr < (uint8_t *) USER_STACK
+		&& (uint8_t *) addr >= (uint8_t *) USER_STACK - USER_STACK_LIMIT
+		&& (uint8_t *) addr >= (uint8_t *) rsp - 8;
+}
+
 /* Growing the stack. */
 static void
-vm_stack_growth (void *addr UNUSED) {
+vm_stack_growth (void *addr) {
+	if (vm_alloc_page (VM_ANON | VM_MARKER_0, pg_round_down (addr), true))
+		thread_current ()->vm_stats.stack_faults++;
 }
 
-/* Handle the fault on write_protected page */
+/* Handle the fault on write_protected page.
+ * PAGE is writable but mapped read-only because it shares its frame with
+ * other pages, since fork() or since same-page merging found them equal.
+ * Give PAGE a private copy of the frame, or, if the others are gone,
+ * simply map the frame writable. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	struct frame *old, *new;
+	bool success;
+
+	lock_acquire (&frame_lock);
+	vm_writeback_wait (page);
+	old = page->frame;
+	if (old == NULL) {
+		/* Evicted since the fault; swapping it in yields a private copy. */
+		lock_release (&frame_lock);
+		return vm_do_claim_page (page);
+	}
+	if (old->merged)
+		ksm_count_unmerge ();
+	page->owner->vm_stats.cow_faults++;
+	page->owner->vm_stats.minor_faults++;
+	if (list_size (&old->pages) == 1) {
+		old->merged = false;
+		success = vm_page_map (page, old->kva, page->writable);
+		lock_release (&frame_lock);
+		return success;
+	}
+	old->pin_cnt++;
+	lock_release (&frame_lock);
+
+	new = vm_get_frame ();
+	memcpy (new->kva, old->kva, PGSIZE);
+
+	lock_acquire (&frame_lock);
+	old->pin_cnt--;
+	if (list_size (&old->pages) == 1) {
+		/* The other sharers exited while we copied, leaving OLD to PAGE
+		 * alone.  Keep it and give back the copy. */
+		old->merged = false;
+		vm_frame_release (new);
+		success = vm_page_map (page, old->kva, page->writable);
+		lock_release (&frame_lock);
+		return success;
+	}
+	vm_frame_unlink (page);
+	vm_frame_link (new, page);
+	new->pin_cnt--;
+	success = vm_page_map (page, new->kva, page->writable);
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Number of pages in the window that fault-around loads on a fault in a
+ * file-backed page, at most FAULT_AROUND_MAX.  0 or 1 disables it.
+ * Controlled by kernel command-line option "-fa=PAGES". */
+size_t fault_around_pages = 16;
+
+/* Pages of the fault-around window that will be loaded together. */
+struct fault_around {
+	struct page *pages[FAULT_AROUND_MAX];
+	size_t cnt;
+	struct page *fault;         /* The page that faulted. */
+	struct file_load_info *info; /* Its lazy-load descriptor. */
+};
+
+/* Returns the lazy-load descriptor of PAGE if PAGE has not been loaded yet
+ * and its contents come from a file, otherwise a null pointer. */
+static struct file_load_info *
+page_pending_file (struct page *page) {
+	struct file_load_info *info;
+
+	if (VM_TYPE (page->operations->type) != VM_UNINIT)
+		return NULL;
+	info = page->uninit.aux;
+	return info != NULL && info->file != NULL ? info : NULL;
+}
+
+/* spt_for_each_range() callback that adds PAGE to the fault-around batch
+ * if it continues the faulting page's segment: loaded the same way from
+ * the same file, at the offset matching its address. */
+static bool
+fault_around_add (struct page *page, void *fa_) {
+	struct fault_around *fa = fa_;
+	struct file_load_info *info = page_pending_file (page);
+
+	if (page != fa->fault && info != NULL
+			&& page->uninit.init == fa->fault->uninit.init
+			&& page->uninit.type == fa->fault->uninit.type
+			&& file_get_inode (info->file) == file_get_inode (fa->info->file)
+			&& (int64_t) info->ofs - fa->info->ofs
+				== (uint8_t *) page->va - (uint8_t *) fa->fault->va)
+		fa->pages[fa->cnt++] = page;
+	return fa->cnt < FAULT_AROUND_MAX;
+}
+
+/* Collects into FA the pages around PAGE, which is about to be loaded,
+ * that fault-around should load along with it.  Must be called before
+ * PAGE is loaded.  The window follows PAGE's madvise() hint. */
+static void
+fault_around_collect (struct fault_around *fa, struct page *page) {
+	size_t window = fault_around_pages < FAULT_AROUND_MAX
+		? fault_around_pages : FAULT_AROUND_MAX;
+	uint8_t *start;
+
+	if (page->advice == MADV_RANDOM)
+		window = 0;
+	else if (page->advice == MADV_SEQUENTIAL)
+		window = FAULT_AROUND_MAX;
+
+	fa->cnt = 0;
+	fa->fault = page;
+	fa->info = page_pending_file (page);
+	if (window <= 1 || fa->info == NULL)
+		return;
+
+	start = (uint8_t *) page->va - pg_no (page->va) % window * PGSIZE;
+	spt_for_each_range (&page->owner->spt, start, start + window * PGSIZE,
+			fault_around_add, fa);
+}
+
+/* Loads and maps the pages collected in FA, as far as free frames last.
+ * Fault-around is only an optimization, so it never evicts a page to
+ * make room and silently skips a page it fails to map or load.
+ *
+ * swap_in() runs a page's initializer, which turns it into an anonymous
+ * or file-backed page and frees its lazy-load information whether or not
+ * the load works.  Such a page cannot be loaded again later, so only a
+ * page that is still VM_UNINIT is ever backed out; like
+ * vm_do_claim_page(), each page is mapped before it is loaded. */
+static void
+fault_around_load (struct fault_around *fa) {
+	uint32_t mapped = 0, loaded = 0;
+	size_t cnt;
+	bool locked;
+
+	/* Pages that other processes have in memory need no I/O at all. */
+	for (size_t i = 0; i < fa->cnt; )
+		if (vm_share_text (fa->pages[i]))
+			fa->pages[i] = fa->pages[--fa->cnt];
+		else
+			i++;
+
+	/* Take every frame before filesys_lock, which must not be held while
+	 * acquiring the frame lock. */
+	for (cnt = 0; cnt < fa->cnt; cnt++) {
+		struct frame *frame = vm_get_free_frame ();
+		if (frame == NULL)
+			break;
+		lock_acquire (&frame_lock);
+		vm_frame_link (frame, fa->pages[cnt]);
+		lock_release (&frame_lock);
+	}
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct page *page = fa->pages[i];
+
+		if (pml4_set_page (page->owner->pml4, page->va, page->frame->kva,
+					page->writable))
+			mapped |= 1u << i;
+		else
+			vm_free_frame (page);
+	}
+
+	/* Read all of the pages under one acquisition of the lock. */
+	locked = vm_filesys_lock ();
+	for (size_t i = 0; i < cnt; i++) {
+		struct page *page = fa->pages[i];
+		if ((mapped & (1u << i)) && swap_in (page, page->frame->kva))
+			loaded |= 1u << i;
+	}
+	vm_filesys_unlock (locked);
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct page *page = fa->pages[i];
+
+		if (!(mapped & (1u << i)))
+			continue;
+		if (loaded & (1u << i))
+			vm_loaded_page (page);
+		else if (VM_TYPE (page->operations->type) == VM_UNINIT)
+			vm_free_frame (page);
+		else {
+			/* Keep the page resident, but do not offer a frame that
+			 * failed to load to other processes. */
+			lock_acquire (&frame_lock);
+			page->frame->pin_cnt--;
+			lock_release (&frame_lock);
+		}
+	}
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
-	struct page *page = NULL;
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
+vm_try_handle_fault (struct intr_frame *f, void *addr,
+		bool user, bool write, bool not_present) {
+	struct thread *curr = thread_current ();
+	struct supplemental_page_table *spt = &curr->spt;
+	struct page *page;
 
-	return vm_do_claim_page (page);
+	if (addr == NULL || is_kernel_vaddr (addr))
+		return false;
+
+	page = spt_find_page (spt, addr);
+	if (page == NULL) {
+		/* Faults inside system calls see the kernel's stack pointer in F,
+		 * so use the one saved on entry to the kernel instead. */
+		void *rsp = user ? (void *) f->rsp : curr->user_rsp;
+		if (!not_present || !vm_is_stack_access (addr, rsp))
+			return false;
+		vm_stack_growth (addr);
+		page = spt_find_page (spt, addr);
+		if (page == NULL)
+			return false;
+	}
+
+	if (write && !page->writable)
+		return false;
+	if (!not_present)
+		return vm_handle_wp (page);
+	return vm_fault_in (page);
+}
+
+/* Loads PAGE, which is not resident, together with its fault-around
+ * window. */
+static bool
+vm_fault_in (struct page *page) {
+	struct fault_around fa;
+
+	fault_around_collect (&fa, page);
+	if (!vm_do_claim_page (page))
+		return false;
+	fault_around_load (&fa);
+	return true;
 }
 
 /* Free the page.
@@ -150,41 +920,340 @@ vm_dealloc_page (struct page *page) {
 
 /* Claim the page that allocate on VA. */
 bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
+vm_claim_page (void *va) {
+	struct page *page = spt_find_page (&thread_current ()->spt, va);
+	if (page == NULL)
+		return false;
 
 	return vm_do_claim_page (page);
 }
 
+/* Maps PAGE to a frame of read-only text that another process already has
+ * in memory, if there is one.  Returns true if successful. */
+static bool
+vm_share_text (struct page *page) {
+	bool shared;
+
+	lock_acquire (&frame_lock);
+	shared = file_text_share (page);
+	lock_release (&frame_lock);
+	return shared;
+}
+
+/* Finishes loading PAGE into its pinned frame: offers the frame to other
+ * processes if it holds read-only text, and unpins it. */
+static void
+vm_loaded_page (struct page *page) {
+	lock_acquire (&frame_lock);
+	file_text_register (page);
+	page->frame->pin_cnt--;
+	lock_release (&frame_lock);
+}
+
+/* Returns true if loading PAGE, which is not resident, takes I/O: it
+ * comes from a file or from swap rather than being zero-filled. */
+static bool
+page_needs_io (struct page *page) {
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			return page_pending_file (page) != NULL;
+		case VM_ANON:
+			return page->anon.swap_slot != SWAP_SLOT_NONE;
+		default:
+			return true;
+	}
+}
+
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	struct vm_stats *stats = &page->owner->vm_stats;
+	struct frame *frame;
+	bool major;
+
+	/* PAGE may be on its way out to swap or its file. */
+	lock_acquire (&frame_lock);
+	vm_writeback_wait (page);
+	lock_release (&frame_lock);
+
+	if (vm_share_text (page)) {
+		stats->minor_faults++;
+		return true;
+	}
+
+	major = page_needs_io (page);
+	frame = vm_get_frame ();
 
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	lock_acquire (&frame_lock);
+	vm_frame_link (frame, page);
+	lock_release (&frame_lock);
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	if (!pml4_set_page (page->owner->pml4, page->va, frame->kva,
+				page->writable)
+			|| !swap_in (page, frame->kva)) {
+		vm_free_frame (page);
+		return false;
+	}
+	vm_loaded_page (page);
+	if (major)
+		stats->major_faults++;
+	else
+		stats->minor_faults++;
+	return true;
+}
 
-	return swap_in (page, frame->kva);
+/* Page faults no longer happen while filesys_lock is held, but the VM
+ * nests its own file I/O: fault_around_load() holds the lock across
+ * swap_in() calls whose initializers read from files too.  File I/O done
+ * on behalf of the VM therefore takes the lock only if the current
+ * thread does not hold it, and returns whether it did so that
+ * vm_filesys_unlock() can undo exactly that. */
+bool
+vm_filesys_lock (void) {
+	if (lock_held_by_current_thread (&filesys_lock))
+		return false;
+	lock_acquire (&filesys_lock);
+	return true;
+}
+
+void
+vm_filesys_unlock (bool acquired) {
+	if (acquired)
+		lock_release (&filesys_lock);
+}
+
+/* spt_for_each_range() callback that counts the pages in a range. */
+static bool
+madvise_count (struct page *page UNUSED, void *cnt_) {
+	size_t *cnt = cnt_;
+
+	(*cnt)++;
+	return true;
+}
+
+/* spt_for_each_range() callback that applies the madvise() hint pointed
+ * to by ADVICE_ to PAGE.  Both loading and evicting are best effort. */
+static bool
+madvise_apply (struct page *page, void *advice_) {
+	int advice = *(int *) advice_;
+
+	switch (advice) {
+		case MADV_WILLNEED:
+			if (page->frame == NULL)
+				vm_fault_in (page);
+			break;
+		case MADV_DONTNEED:
+			vm_reclaim_page (page);
+			break;
+		default:
+			page->advice = advice;
+			break;
+	}
+	return true;
+}
+
+/* Applies ADVICE, one of the MADV_* values, to the pages of the current
+ * process in [ADDR, ADDR + LENGTH).  MADV_NORMAL, MADV_RANDOM and
+ * MADV_SEQUENTIAL set how far fault-around and swap readahead reach for
+ * those pages, MADV_WILLNEED loads them now, and MADV_DONTNEED evicts
+ * them now.  ADDR must be page-aligned.  Returns false if ADVICE is
+ * invalid or some page in the range is not mapped. */
+bool
+vm_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	uint8_t *end = (uint8_t *) addr + page_cnt * PGSIZE;
+	size_t mapped_cnt = 0;
+
+	if (pg_ofs (addr) != 0 || advice < MADV_NORMAL || advice > MADV_DONTNEED
+			|| end < (uint8_t *) addr || (page_cnt > 0
+				&& (addr == NULL || is_kernel_vaddr (end - 1))))
+		return false;
+
+	spt_for_each_range (spt, addr, end, madvise_count, &mapped_cnt);
+	if (mapped_cnt != page_cnt)
+		return false;
+	spt_for_each_range (spt, addr, end, madvise_apply, &advice);
+	return true;
+}
+
+/* Print each user process's paging statistics when it exits?
+ * Controlled by kernel command-line option "-vmstat". */
+bool vm_exit_stats;
+
+/* Prints the current process's paging statistics. */
+void
+vm_print_process_stats (void) {
+	struct thread *curr = thread_current ();
+	struct vm_stats *stats = &curr->vm_stats;
+
+	printf ("%s: %lld minor and %lld major faults (%lld cow, %lld stack), "
+			"%lld swap-ins, rss %zu pages (peak %zu)\n", curr->name,
+			stats->minor_faults, stats->major_faults, stats->cow_faults,
+			stats->stack_faults, stats->swap_ins, stats->rss, stats->peak_rss);
 }
 
 /* Initialize new supplemental page table */
 void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	spt->root = NULL;
+}
+
+/* Adds to the current thread's supplemental page table a copy-on-write
+ * copy of SRC_PAGE, an anonymous page of the parent.  A resident page
+ * shares the parent's frame, mapped read-only in both processes until
+ * one of them writes to it; a swapped-out page shares the swap slot. */
+static bool
+spt_share_page (struct page *src_page) {
+	struct thread *curr = thread_current ();
+	struct page *dst_page = malloc (sizeof *dst_page);
+	struct frame *frame;
+	bool success = true;
+
+	if (dst_page == NULL)
+		return false;
+
+	lock_acquire (&frame_lock);
+	vm_writeback_wait (src_page);
+	*dst_page = (struct page) {
+		.va = src_page->va,
+		.writable = src_page->writable,
+		.owner = curr,
+	};
+	anon_share (dst_page, src_page);
+	if (!spt_insert_page (&curr->spt, dst_page)) {
+		lock_release (&frame_lock);
+		vm_dealloc_page (dst_page);
+		return false;
+	}
+
+	frame = src_page->frame;
+	if (frame != NULL) {
+		vm_frame_link (frame, dst_page);
+		success = vm_page_map (src_page, frame->kva, false)
+			&& vm_page_map (dst_page, frame->kva, false);
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Duplicates SRC_PAGE, one page of the parent, into the current thread's
+ * supplemental page table.  Pages that were never touched stay lazy, as
+ * does read-only text, anonymous pages are shared copy-on-write, and
+ * resident mmap pages get a private copy of their contents. */
+static bool
+spt_dup_page (struct page *src_page) {
+	enum vm_type type = page_get_type (src_page);
+	struct file_load_info *info = NULL;
+	struct page *dst_page;
+
+	if (VM_TYPE (src_page->operations->type) == VM_UNINIT) {
+		if (src_page->uninit.aux != NULL) {
+			info = file_load_info_dup (src_page->uninit.aux);
+			if (info == NULL)
+				return false;
+		}
+		if (!vm_alloc_page_with_initializer (src_page->uninit.type,
+					src_page->va, src_page->writable, src_page->uninit.init, info)) {
+			file_load_info_free (info);
+			return false;
+		}
+		return true;
+	}
+
+	if (type == VM_ANON)
+		return spt_share_page (src_page);
+
+	if (type == VM_FILE) {
+		struct file_load_info src_info = {
+			.file = src_page->file.file,
+			.ofs = src_page->file.ofs,
+			.read_bytes = src_page->file.read_bytes,
+			.mapped_pages = src_page->file.mapped_pages,
+			.shared = src_page->file.shared,
+		};
+		info = file_load_info_dup (&src_info);
+		if (info == NULL)
+			return false;
+
+		/* Read-only text is found in the shared text table on the
+		 * child's first access. */
+		if (src_info.shared) {
+			if (!vm_alloc_page_with_initializer (VM_FILE, src_page->va,
+						src_page->writable, file_load_page, info)) {
+				file_load_info_free (info);
+				return false;
+			}
+			return true;
+		}
+	}
+	if (!vm_alloc_page_with_initializer (type, src_page->va,
+				src_page->writable, NULL, info)) {
+		file_load_info_free (info);
+		return false;
+	}
+
+	/* Either page could be evicted to make room for the other, so pin
+	 * both while copying. */
+	dst_page = spt_find_page (&thread_current ()->spt, src_page->va);
+	if (!vm_pin_page (src_page, false))
+		return false;
+	if (!vm_pin_page (dst_page, false)) {
+		vm_unpin_page (src_page);
+		return false;
+	}
+	memcpy (dst_page->frame->kva, src_page->frame->kva, PGSIZE);
+	vm_unpin_page (dst_page);
+	vm_unpin_page (src_page);
+	return true;
+}
+
+/* spt_for_each_range() callback that duplicates SRC_PAGE into the
+ * current thread's supplemental page table, along with its madvise()
+ * hint. */
+static bool
+spt_copy_page (struct page *src_page, void *aux UNUSED) {
+	if (!spt_dup_page (src_page))
+		return false;
+	spt_find_page (&thread_current ()->spt, src_page->va)->advice
+		= src_page->advice;
+	return true;
 }
 
 /* Copy supplemental page table from src to dst */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	ASSERT (dst == &thread_current ()->spt);
+
+	return spt_for_each_range (src, NULL, (void *) KERN_BASE, spt_copy_page,
+			NULL);
+}
+
+/* Frees NODE, a node at LEVEL, together with every node and page below
+ * it. */
+static void
+spt_node_kill (struct spt_node *node, int level) {
+	for (size_t i = 0; i < SPT_FANOUT; i++) {
+		if (node->slots[i] == NULL)
+			continue;
+		if (level == SPT_LEVELS - 1)
+			vm_dealloc_page (node->slots[i]);
+		else
+			spt_node_kill (node->slots[i], level + 1);
+	}
+	palloc_free_page (node);
 }
 
 /* Free the resource hold by the supplemental page table */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	/* Destroying a page writes back its modified contents, if it has a
+	 * backing store, and releases its frame. */
+	struct spt_node *root = spt->root;
+
+	spt->root = NULL;
+	if (root != NULL)
+		spt_node_kill (root, 0);
 }
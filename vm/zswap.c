@@ -0,0 +1,342 @@
+/* zswap.c: Compressed cache in front of the swap disk.
+ *
+ * When enabled with the "-zswap=PAGES" kernel option, a page written to
+ * swap is first compressed and, if it shrinks to half a page or less,
+ * kept in memory instead of going to disk.  Its swap slot stays
+ * allocated, so the page can still be written there later.  The cache
+ * holds at most PAGES pages worth of compressed data; to make room, the
+ * oldest entries are decompressed and written back to their slots.
+ *
+ * Writing an entry back takes disk I/O, so it happens in two steps.
+ * zswap_store() only takes the entries it makes room from off the LRU
+ * list and hands them to the caller as victims.  They stay in the cache,
+ * so zswap_load() still serves them from memory, until the caller has
+ * written them out with zswap_write_victims() and dropped them with
+ * zswap_victim_done().
+ *
+ * The compressor is a small LZ77 variant in the spirit of LZ4: a hash
+ * table of recent 4-byte sequences finds matches, and the output is a
+ * sequence of literal runs and (length, offset) back-references.  Anonymous
+ * pages tend to be mostly zeros or repeated patterns, which it handles
+ * well and quickly.
+ *
+ * All functions but zswap_write_victims() are called with the swap lock
+ * held. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed format.  A byte below LZ_MATCH starts a run of that many
+ * plus one literal bytes; a byte B at or above it is a match of
+ * B - LZ_MATCH + LZ_MIN_MATCH bytes at the 16-bit little-endian offset
+ * that follows. */
+#define LZ_MATCH 0x80
+#define LZ_MAX_LITERALS LZ_MATCH
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_MATCH (0xff - LZ_MATCH + LZ_MIN_MATCH)
+
+/* log2 of the number of entries in the compressor's hash table. */
+#define LZ_HASH_BITS 10
+
+/* Pages that compress to more than this many bytes go to disk. */
+#define ZSWAP_MAX_LEN (PGSIZE / 2 - sizeof (struct zswap_entry))
+
+size_t zswap_pages;
+
+/* A compressed page. */
+struct zswap_entry {
+	size_t slot;                /* Swap slot it stands in for. */
+	size_t len;                 /* Bytes in DATA. */
+	bool victim;                /* Being written back to disk? */
+	struct list_elem elem;      /* Element in zswap_lru or a victim list. */
+	uint8_t data[];             /* Compressed contents. */
+};
+
+/* Entries by swap slot, and all entries, oldest first. */
+static struct zswap_entry **zswap_map;
+static struct list zswap_lru;
+
+/* Compressed bytes held by entries on zswap_lru, and the most allowed. */
+static size_t zswap_bytes;
+static size_t zswap_limit;
+
+static zswap_writeback_func *zswap_writeback;
+
+/* Scratch space: compressor output, a page to decompress into for
+ * writeback, and the compressor's hash table of positions plus one.
+ * ZSWAP_PAGE is used without the swap lock, under its own lock. */
+static uint8_t *zswap_buf;
+static uint8_t *zswap_page;
+static struct lock zswap_page_lock;
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+/* Statistics. */
+static long long store_cnt;     /* Pages stored compressed. */
+static long long reject_cnt;    /* Pages that did not compress enough. */
+static long long writeback_cnt; /* Entries written back to disk. */
+static long long lookup_cnt;    /* Swap-ins looked up in the cache. */
+static long long load_cnt;      /* Swap-ins served from the cache. */
+static long long stored_bytes;  /* Compressed size of the pages stored. */
+
+/* Sets up the cache for a swap disk of SLOT_CNT slots, if it is enabled.
+ * WRITEBACK writes a page to its slot on disk. */
+void
+zswap_init (size_t slot_cnt, zswap_writeback_func *writeback) {
+	if (zswap_pages == 0 || slot_cnt == 0) {
+		zswap_pages = 0;
+		return;
+	}
+	zswap_map = calloc (slot_cnt, sizeof *zswap_map);
+	if (zswap_map == NULL)
+		PANIC ("zswap_init: cannot allocate slot map");
+	list_init (&zswap_lru);
+	zswap_bytes = 0;
+	zswap_limit = zswap_pages * PGSIZE;
+	zswap_writeback = writeback;
+	zswap_buf = palloc_get_page (PAL_ASSERT);
+	zswap_page = palloc_get_page (PAL_ASSERT);
+	lock_init (&zswap_page_lock);
+}
+
+/* Returns the hash table index for the 4 bytes at P. */
+static size_t
+lz_hash (const uint8_t *p) {
+	uint32_t seq;
+
+	memcpy (&seq, p, sizeof seq);
+	return (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Appends the CNT literal bytes at SRC to DST, which holds *OP of CAP
+ * bytes.  Returns false if they do not fit. */
+static bool
+lz_put_literals (uint8_t *dst, size_t *op, size_t cap,
+		const uint8_t *src, size_t cnt) {
+	while (cnt > 0) {
+		size_t run = cnt < LZ_MAX_LITERALS ? cnt : LZ_MAX_LITERALS;
+
+		if (*op + 1 + run > cap)
+			return false;
+		dst[(*op)++] = run - 1;
+		memcpy (dst + *op, src, run);
+		*op += run;
+		src += run;
+		cnt -= run;
+	}
+	return true;
+}
+
+/* Compresses the page at SRC into DST, which has room for CAP bytes.
+ * Returns the compressed length, or 0 if it would exceed CAP. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t cap) {
+	size_t ip = 0, op = 0, lit = 0;
+
+	memset (lz_table, 0, sizeof lz_table);
+	while (ip + LZ_MIN_MATCH <= PGSIZE) {
+		size_t h = lz_hash (src + ip);
+		size_t cand = lz_table[h];
+		size_t len;
+
+		lz_table[h] = ip + 1;
+		if (cand == 0 || memcmp (src + cand - 1, src + ip, LZ_MIN_MATCH)) {
+			ip++;
+			continue;
+		}
+		cand--;
+		len = LZ_MIN_MATCH;
+		while (ip + len < PGSIZE && len < LZ_MAX_MATCH
+				&& src[cand + len] == src[ip + len])
+			len++;
+
+		if (!lz_put_literals (dst, &op, cap, src + lit, ip - lit)
+				|| op + 3 > cap)
+			return 0;
+		dst[op++] = LZ_MATCH + len - LZ_MIN_MATCH;
+		dst[op++] = (ip - cand) & 0xff;
+		dst[op++] = (ip - cand) >> 8;
+		ip += len;
+		lit = ip;
+	}
+	if (!lz_put_literals (dst, &op, cap, src + lit, PGSIZE - lit))
+		return 0;
+	return op;
+}
+
+/* Decompresses the LEN bytes at SRC, made by lz_compress(), into the page
+ * at DST. */
+static void
+lz_decompress (const uint8_t *src, size_t len, uint8_t *dst) {
+	const uint8_t *end = src + len;
+	size_t op = 0;
+
+	while (src < end) {
+		unsigned token = *src++;
+
+		if (token < LZ_MATCH) {
+			size_t run = token + 1;
+
+			ASSERT (op + run <= PGSIZE);
+			memcpy (dst + op, src, run);
+			src += run;
+			op += run;
+		} else {
+			size_t run = token - LZ_MATCH + LZ_MIN_MATCH;
+			size_t ofs = src[0] | (src[1] << 8);
+
+			src += 2;
+			ASSERT (ofs > 0 && ofs <= op && op + run <= PGSIZE);
+			/* The match may overlap the bytes it produces. */
+			for (size_t i = 0; i < run; i++, op++)
+				dst[op] = dst[op - ofs];
+		}
+	}
+	ASSERT (op == PGSIZE);
+}
+
+/* Removes ENTRY, which is on zswap_lru, from the cache and frees it. */
+static void
+zswap_remove (struct zswap_entry *entry) {
+	ASSERT (!entry->victim);
+	zswap_map[entry->slot] = NULL;
+	list_remove (&entry->elem);
+	zswap_bytes -= entry->len;
+	free (entry);
+}
+
+/* Takes the oldest entry off zswap_lru and adds it to VICTIMS. */
+static void
+zswap_evict (struct list *victims) {
+	struct zswap_entry *entry = list_entry (list_pop_front (&zswap_lru),
+			struct zswap_entry, elem);
+
+	entry->victim = true;
+	zswap_bytes -= entry->len;
+	list_push_back (victims, &entry->elem);
+}
+
+/* Stores the page at KVA in the cache in place of writing it to SLOT.
+ * Returns false if the cache is disabled or the page does not compress
+ * well, in which case the caller must write it to disk.  Either way, adds
+ * the entries that must be written back to make room to VICTIMS. */
+bool
+zswap_store (size_t slot, const void *kva, struct list *victims) {
+	struct zswap_entry *entry;
+	size_t len;
+
+	if (zswap_pages == 0)
+		return false;
+	ASSERT (zswap_map[slot] == NULL);
+
+	len = lz_compress (kva, zswap_buf, ZSWAP_MAX_LEN);
+	if (len == 0) {
+		reject_cnt++;
+		return false;
+	}
+	while (zswap_bytes + len > zswap_limit && !list_empty (&zswap_lru))
+		zswap_evict (victims);
+	entry = malloc (sizeof *entry + len);
+	if (entry == NULL) {
+		reject_cnt++;
+		return false;
+	}
+
+	entry->slot = slot;
+	entry->len = len;
+	entry->victim = false;
+	memcpy (entry->data, zswap_buf, len);
+	list_push_back (&zswap_lru, &entry->elem);
+	zswap_map[slot] = entry;
+	zswap_bytes += len;
+	store_cnt++;
+	stored_bytes += len;
+	return true;
+}
+
+/* Returns the slot of victim ELEM, from a list filled by zswap_store(). */
+size_t
+zswap_victim_slot (struct list_elem *elem) {
+	return list_entry (elem, struct zswap_entry, elem)->slot;
+}
+
+/* Writes each entry in VICTIMS back to its slot on disk.  Called without
+ * the swap lock; the caller must keep the slots from being freed until
+ * it has passed each entry to zswap_victim_done(). */
+void
+zswap_write_victims (struct list *victims) {
+	struct list_elem *e;
+
+	for (e = list_begin (victims); e != list_end (victims); e = list_next (e)) {
+		struct zswap_entry *entry = list_entry (e, struct zswap_entry, elem);
+
+		lock_acquire (&zswap_page_lock);
+		lz_decompress (entry->data, entry->len, zswap_page);
+		zswap_writeback (entry->slot, zswap_page);
+		lock_release (&zswap_page_lock);
+	}
+}
+
+/* Drops victim ELEM, which zswap_write_victims() has written back, from
+ * the cache and frees it.  Returns its slot. */
+size_t
+zswap_victim_done (struct list_elem *elem) {
+	struct zswap_entry *entry = list_entry (elem, struct zswap_entry, elem);
+	size_t slot = entry->slot;
+
+	ASSERT (entry->victim);
+	zswap_map[slot] = NULL;
+	writeback_cnt++;
+	free (entry);
+	return slot;
+}
+
+/* Reads SLOT into KVA if the cache holds it.  Returns true if so. */
+bool
+zswap_load (size_t slot, void *kva) {
+	struct zswap_entry *entry;
+
+	if (zswap_pages == 0)
+		return false;
+	lookup_cnt++;
+	entry = zswap_map[slot];
+	if (entry == NULL)
+		return false;
+	lz_decompress (entry->data, entry->len, kva);
+	load_cnt++;
+	return true;
+}
+
+/* Returns true if the cache holds SLOT. */
+bool
+zswap_contains (size_t slot) {
+	return zswap_pages != 0 && zswap_map[slot] != NULL;
+}
+
+/* Drops SLOT, which has been freed, from the cache. */
+void
+zswap_forget (size_t slot) {
+	if (zswap_pages != 0 && zswap_map[slot] != NULL)
+		zswap_remove (zswap_map[slot]);
+}
+
+/* Prints compressed cache statistics. */
+void
+zswap_print_stats (void) {
+	if (zswap_pages == 0)
+		return;
+	printf ("Zswap: %lld pages stored (%lld%% of original size), "
+			"%lld rejected, %lld written back\n", store_cnt,
+			store_cnt > 0 ? stored_bytes * 100 / (store_cnt * PGSIZE) : 0,
+			reject_cnt, writeback_cnt);
+	printf ("Zswap: %lld of %lld swap-ins served from memory (%lld%%)\n",
+			load_cnt, lookup_cnt,
+			lookup_cnt > 0 ? load_cnt * 100 / lookup_cnt : 0);
+}